@@ -1,4 +1,13 @@
-bddMgr.o: bddMgr.cpp bddNode.h bddMgr.h myHash.h
-bddNode.o: bddNode.cpp bddNode.h bddMgr.h myHash.h
+bddCompiled.o: bddCompiled.cpp bddNode.h myPool.h myBigNum.h bddMgr.h \
+ myHash.h bddCompiled.h
+bddCount.o: bddCount.cpp bddNode.h myPool.h myBigNum.h bddMgr.h myHash.h
+bddMgr.o: bddMgr.cpp bddNode.h myPool.h myBigNum.h bddMgr.h myHash.h
+bddNode.o: bddNode.cpp bddNode.h myPool.h myBigNum.h bddMgr.h myHash.h
+bddPar.o: bddPar.cpp bddNode.h myPool.h myBigNum.h bddMgr.h myHash.h
+bddReorder.o: bddReorder.cpp bddNode.h myPool.h myBigNum.h bddMgr.h \
+ myHash.h
 myString.o: myString.cpp
-testBdd.o: testBdd.cpp bddNode.h bddMgr.h myHash.h
+testBdd.o: testBdd.cpp bddNode.h myPool.h myBigNum.h bddMgr.h myHash.h \
+ bddCompiled.h
+benchBdd.o: benchBdd.cpp bddNode.h myPool.h myBigNum.h bddMgr.h myHash.h \
+ bddCompiled.h
@@ -0,0 +1,59 @@
+/****************************************************************************
+  FileName     [ bddCompiled.cpp ]
+  PackageName  [ ]
+  Synopsis     [ Compile BDDs into BddCompiled ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2005-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cassert>
+#include "bddNode.h"
+#include "bddMgr.h"
+#include "bddCompiled.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    class BddCompiled
+//----------------------------------------------------------------------
+void
+BddCompiled::compile(const vector<BddNode>& roots)
+{
+   // The roots are read through their BddMgr, current or not
+   // ==> no node is created, so there is no garbage collection or
+   //     reordering while walking through the BDDs
+   BddMgr* mgr = roots.empty()? 0 : BddMgr::ownerOf(roots[0]);
+   _nodes.assign(1, BddCompiledNode());
+   _nodes[0]._var = 0;
+   _nodes[0]._child[0] = _nodes[0]._child[1] = 0;
+   _roots.resize(roots.size());
+   BddNodeMemo<unsigned> memo;
+   for (size_t i = 0, n = roots.size(); i < n; ++i) {
+      assert(BddMgr::ownerOf(roots[i]) == mgr);
+      _roots[i] = mgr->compileRecur(roots[i](), memo, _nodes);
+   }
+}
+
+// Return the edge of e in nodes; the children are appended first
+unsigned
+BddMgr::compileRecur(size_t e, BddNodeMemo<unsigned>& memo,
+                     vector<BddCompiledNode>& nodes) const
+{
+   BddNodeInt* n = getNodeInt(e);
+   unsigned neg = (e & BDD_NEG_EDGE)? 1 : 0;
+   if (n == getTerminal()) return neg;
+   size_t p = e & ~size_t(BDD_NEG_EDGE);
+   const unsigned* ip = memo.find(p);
+   if (ip) return (*ip) ^ neg;
+
+   BddCompiledNode c;
+   c._var = _level2Var[n->getLevel()];
+   c._child[1] = compileRecur(n->getLeftEdge(), memo, nodes);
+   c._child[0] = compileRecur(n->getRightEdge(), memo, nodes);
+   // the index is shifted left by 1
+   assert(nodes.size() < (size_t(1) << 31));
+   unsigned i = unsigned(nodes.size()) << 1;
+   nodes.push_back(c);
+   memo.insert(p, i);
+   return i ^ neg;
+}
@@ -0,0 +1,94 @@
+/****************************************************************************
+  FileName     [ bddCompiled.h ]
+  PackageName  [ ]
+  Synopsis     [ Define the compiled (flattened, read-only) BDD ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2005-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef BDD_COMPILED_H
+#define BDD_COMPILED_H
+
+#include <vector>
+#include <string>
+#include <cassert>
+
+using namespace std;
+
+class BddNode;
+
+// A node of BddCompiled, in 12 bytes
+// _child[1] is the left (then) edge and _child[0] the right (else) edge,
+// as (node index << 1) | complement flag
+// ==> index 0 is the const 1; i.e. edge 0 is const 1, edge 1 is const 0
+struct BddCompiledNode
+{
+   unsigned     _var;
+   unsigned     _child[2];
+};
+
+// A snapshot of the BDDs of some roots, as a flat array of nodes in the
+// topological order (i.e. the children before their parents). It keeps
+// the variables (not the levels), and does not refer to BddMgr at all
+// ==> it stays valid after garbage collection, reordering, and even
+//     after the BddMgr is deleted
+// ==> it is read-only, so it can be shared by any number of threads
+//
+// Evaluating a root is one pass from the root to a terminal, with no
+// branch on the variable values:
+//    e = _nodes[e >> 1]._child[value of _var] ^ (e & 1)
+//
+class BddCompiled
+{
+public:
+   BddCompiled() {}
+   BddCompiled(const BddNode& f) { compile(vector<BddNode>(1, f)); }
+   BddCompiled(const vector<BddNode>& roots) { compile(roots); }
+
+   // The nodes shared by the roots are compiled only once
+   void compile(const vector<BddNode>& roots);
+
+   // bits[v] = the value of variable v (bits is indexed as
+   // BddMgr::_supports, as in BddSampler)
+   bool eval(size_t r, const vector<bool>& bits) const {
+      assert(r < _roots.size());
+      unsigned e = _roots[r];
+      while (e > 1) {
+         const BddCompiledNode& n = _nodes[e >> 1];
+         assert(n._var < bits.size());
+         e = n._child[bits[n._var]] ^ (e & 1);
+      }
+      return (e == 0);
+   }
+   // the same, with pattern[v-1] = '0' or '1' for variable v, as in
+   // BddMgr::evalCube()
+   // [Note] Unlike evalCube(), a bad pattern (e.g. a '-' as in
+   //        BddCubeIter, or too short for the variables on the path) is
+   //        only caught by assertions
+   bool eval(size_t r, const string& pattern) const {
+      assert(r < _roots.size());
+      unsigned e = _roots[r];
+      while (e > 1) {
+         const BddCompiledNode& n = _nodes[e >> 1];
+         assert(n._var <= pattern.size());
+         char c = pattern[n._var - 1];
+         assert(c == '0' || c == '1');
+         e = n._child[c - '0'] ^ (e & 1);
+      }
+      return (e == 0);
+   }
+
+   size_t getNumRoots() const { return _roots.size(); }
+   // including the const 1
+   size_t getNumNodes() const { return _nodes.size(); }
+   // in bytes
+   size_t memUsage() const {
+      return _nodes.size() * sizeof(BddCompiledNode) +
+             _roots.size() * sizeof(unsigned); }
+
+private:
+   vector<BddCompiledNode>    _nodes;
+   vector<unsigned>           _roots;
+};
+
+#endif // BDD_COMPILED_H
@@ -0,0 +1,247 @@
+/****************************************************************************
+  FileName     [ bddCount.cpp ]
+  PackageName  [ ]
+  Synopsis     [ Model counting, probability and sampling of BDDs ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2005-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <cmath>
+#include <cfloat>
+#include <cassert>
+#include "bddNode.h"
+#include "bddMgr.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    Model counting
+//----------------------------------------------------------------------
+// The probability of f = 1, with P(x) = probability of variable x = 1,
+//    P(f) = P(x) * P(f|x=1) + (1 - P(x)) * P(f|x=0)
+// which does not depend on the skipped levels.
+// [Note] P(~f) is kept along with P(f), instead of being computed as
+//        1 - P(f), which loses all the precision when P(f) is close to 1
+//
+// The floating modes of model counting are by the density of f, i.e.
+//    density(f) = #minterms(f) / 2^nvars = P(f) with all P(x) = 0.5
+// which never overflows, but underflows below 2^-16382 (i.e. for f of
+// more than about 16000 levels)
+// ==> satCountLog2() runs on log2(density) instead (see logProbRecur())
+// ==> satCount() falls back to it for a density out of the normal range
+//
+long double
+BddMgr::satCount(const BddNode& f, unsigned nvars) const
+{
+   assert(nvars >= f.getLevel());
+   BddNodeMemo<BddProb> memo;
+   long double d = probRecur(f(), 0, memo).first;
+   if (d >= LDBL_MIN || getNodeInt(f()) == getTerminal())
+      return ldexpl(d, nvars);
+   return exp2l(satCountLog2(f, nvars));
+}
+
+long double
+BddMgr::satCountLog2(const BddNode& f, unsigned nvars) const
+{
+   assert(nvars >= f.getLevel());
+   BddNodeMemo<BddProb> memo;
+   return logProbRecur(f(), memo).first + nvars;
+}
+
+double
+BddMgr::probability(const BddNode& f, const vector<double>& probs) const
+{
+   assert(probs.size() == _supports.size());
+   BddNodeMemo<BddProb> memo;
+   return probRecur(f(), &probs, memo).first;
+}
+
+// All the roots share one memo ==> each node is visited only once
+void
+BddMgr::probability(const vector<BddNode>& fs, const vector<double>& probs,
+                    vector<double>& res) const
+{
+   assert(probs.size() == _supports.size());
+   BddNodeMemo<BddProb> memo;
+   res.resize(fs.size());
+   for (size_t i = 0, n = fs.size(); i < n; ++i)
+      res[i] = probRecur(fs[i](), &probs, memo).first;
+}
+
+// The exact mode counts over the levels 1 ~ (level of the node), i.e.
+//    count(f) = count(f|x=1) * 2^(#levels skipped by the left edge)
+//             + count(f|x=0) * 2^(#levels skipped by the right edge)
+//    count(~f) = 2^(level of f) - count(f)
+//
+BigNum
+BddMgr::satCountExact(const BddNode& f, unsigned nvars) const
+{
+   assert(nvars >= f.getLevel());
+   BddNodeMemo<BigNum> memo;
+   return satCountRecur(f(), memo) << (nvars - f.getLevel());
+}
+
+// Return (P(e), P(~e)); P(x) = 0.5 for all x if probs = 0
+BddProb
+BddMgr::probRecur(size_t e, const vector<double>* probs,
+                  BddNodeMemo<BddProb>& memo) const
+{
+   BddNodeInt* n = getNodeInt(e);
+   BddProb d(1, 0);
+   if (n != getTerminal()) {
+      size_t p = e & ~size_t(BDD_NEG_EDGE);
+      const BddProb* dp = memo.find(p);
+      if (dp) d = *dp;
+      else {
+         BddProb t = probRecur(n->getLeftEdge(), probs, memo);
+         BddProb f = probRecur(n->getRightEdge(), probs, memo);
+         if (probs) {
+            long double px = (*probs)[_level2Var[n->getLevel()]];
+            d.first = px * t.first + (1 - px) * f.first;
+            d.second = px * t.second + (1 - px) * f.second;
+         }
+         else {
+            d.first = (t.first + f.first) / 2;
+            d.second = (t.second + f.second) / 2;
+         }
+         memo.insert(p, d);
+      }
+   }
+   if (e & BDD_NEG_EDGE) swap(d.first, d.second);
+   return d;
+}
+
+// log2 of the mean of 2^a and 2^b, i.e. log2((2^a + 2^b) / 2), with no
+// overflow or underflow in between
+static long double
+log2Mean(long double a, long double b)
+{
+   if (a < b) swap(a, b);
+   if (isinf(a)) return a;      // both -inf
+   return a + log2l(1 + exp2l(b - a)) - 1;
+}
+
+// Return (log2(density(e)), log2(density(~e))), as probRecur() with
+// P(x) = 0.5 for all x; -inf for a density of 0
+BddProb
+BddMgr::logProbRecur(size_t e, BddNodeMemo<BddProb>& memo) const
+{
+   BddNodeInt* n = getNodeInt(e);
+   BddProb d(0, -INFINITY);
+   if (n != getTerminal()) {
+      size_t p = e & ~size_t(BDD_NEG_EDGE);
+      const BddProb* dp = memo.find(p);
+      if (dp) d = *dp;
+      else {
+         BddProb t = logProbRecur(n->getLeftEdge(), memo);
+         BddProb f = logProbRecur(n->getRightEdge(), memo);
+         d.first = log2Mean(t.first, f.first);
+         d.second = log2Mean(t.second, f.second);
+         memo.insert(p, d);
+      }
+   }
+   if (e & BDD_NEG_EDGE) swap(d.first, d.second);
+   return d;
+}
+
+BigNum
+BddMgr::satCountRecur(size_t e, BddNodeMemo<BigNum>& memo) const
+{
+   BddNodeInt* n = getNodeInt(e);
+   unsigned v = n->getLevel();
+   BigNum c(1);
+   if (n != getTerminal()) {
+      size_t p = e & ~size_t(BDD_NEG_EDGE);
+      const BigNum* cp = memo.find(p);
+      if (cp) c = *cp;
+      else {
+         size_t l = n->getLeftEdge(), r = n->getRightEdge();
+         c = satCountRecur(l, memo) << (v - 1 - getNodeInt(l)->getLevel());
+         c += satCountRecur(r, memo) << (v - 1 - getNodeInt(r)->getLevel());
+         memo.insert(p, c);
+      }
+   }
+   return (e & BDD_NEG_EDGE)? BigNum::pow2(v) - c : c;
+}
+
+// P(e) from the memo filled by probRecur()
+long double
+BddMgr::getProb(size_t e, const BddNodeMemo<BddProb>& memo) const
+{
+   bool isNeg = (e & BDD_NEG_EDGE);
+   if (getNodeInt(e) == getTerminal())
+      return isNeg? 0 : 1;
+   const BddProb* p = memo.find(e & ~size_t(BDD_NEG_EDGE));
+   assert(p != 0);
+   return isNeg? p->second : p->first;
+}
+
+// Set the variables on a random path from e to the const 1
+void
+BddMgr::sampleMinterm(size_t e, const BddNodeMemo<BddProb>& memo,
+                      mt19937_64& rng, vector<bool>& bits) const
+{
+   BddNodeInt* one = getTerminal();
+   for (BddNodeInt* p = getNodeInt(e); p != one; p = getNodeInt(e)) {
+      size_t isNeg = e & BDD_NEG_EDGE;
+      size_t t = p->getLeftEdge() ^ isNeg, f = p->getRightEdge() ^ isNeg;
+      long double pt = getProb(t, memo), pf = getProb(f, memo);
+      // uniform in [0, 1) with 53 bits
+      double r = (rng() >> 11) * (1.0 / 9007199254740992.0);
+      bool isLeft = (r * (pt + pf) < pt);
+      bits[_level2Var[p->getLevel()]] = isLeft;
+      e = isLeft? t : f;
+   }
+   assert(e == _supports[0]());
+}
+
+//----------------------------------------------------------------------
+//    class BddSampler
+//----------------------------------------------------------------------
+// A minterm is drawn by walking from the root to the const 1, and taking
+// the left (then) edge with probability P(left) / (P(left) + P(right)).
+// The variables that are not on the path are set at random.
+//
+BddSampler::BddSampler(const BddNode& f, unsigned long long seed)
+: _mgr(BddMgr::ownerOf(f)), _root(f), _rng(seed)
+{
+   computeDensities();
+}
+
+// The densities depend on the order ==> taken again after reordering
+void
+BddSampler::computeDensities()
+{
+   _numReorders = _mgr->getNumReorders();
+   _memo.clear();
+   BddProb d = _mgr->probRecur(_root(), 0, _memo);
+   assert(d.first > 0 || d.second == 1); (void)d;
+}
+
+bool
+BddSampler::sample(vector<bool>& bits)
+{
+   // f = 0 (of _mgr)
+   if (_root() == (_mgr->getSupport(0)() ^ BDD_NEG_EDGE)) return false;
+   if (_mgr->getNumReorders() != _numReorders) computeDensities();
+
+   size_t n = _mgr->getNumSupports();
+   bits.resize(n);
+   for (size_t i = 1; i < n; i += 64) {
+      unsigned long long r = _rng();
+      for (size_t j = i, m = min(i + 64, n); j < m; ++j, r >>= 1)
+         bits[j] = (r & 1);
+   }
+   _mgr->sampleMinterm(_root(), _memo, _rng, bits);
+   return true;
+}
+
+size_t
+BddSampler::sample(size_t n, vector<vector<bool> >& samples)
+{
+   samples.resize(n);
+   for (size_t i = 0; i < n; ++i)
+      if (!sample(samples[i])) { samples.clear(); return 0; }
+   return n;
+}
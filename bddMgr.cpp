@@ -9,16 +9,14 @@
 #include <fstream>
 #include <iomanip>
 #include <cassert>
+#include <new>
+#include <ctime>
+#include <cstdlib>
 #include "bddNode.h"
 #include "bddMgr.h"
 
 using namespace std;
 
-//----------------------------------------------------------------------
-//    Global variables
-//----------------------------------------------------------------------
-BddMgr* bddMgr = new BddMgr;
-
 //----------------------------------------------------------------------
 //    External functions
 //----------------------------------------------------------------------
@@ -37,36 +35,140 @@ static void swapBddNode(BddNode& f, BddNode& g)
 //----------------------------------------------------------------------
 BddNode getBddNode(const string& bddName)
 {
+   BddMgr* m = BddNode::getBddMgr();
+   assert(m != 0);
    int id;
    if (myStr2Int(bddName, id))  // bddName is an ID
-      return bddMgr->getBddNode(id);
-   else // bddNameis a name
-      return bddMgr->getBddNode(bddName);
+      return m->getBddNode(id);
+   else // bddName is a name
+      return m->getBddNode(bddName);
 }
 
 //----------------------------------------------------------------------
 //    class BddMgr
 //----------------------------------------------------------------------
+thread_local BddMgr** BddMgr::_currMgrs = 0;
+thread_local unsigned BddMgr::_numCurrMgrs = 0;
+thread_local unsigned BddMgr::_capCurrMgrs = 0;
+
 // _level = 0 ==> const 1 & const 0
 // _level = 1 ~ nin ==> supports
 //
 void
 BddMgr::init(size_t nin, size_t h, size_t c)
 {
+   BddMgr* prev = BddNode::getBddMgr();
    reset();
-   _uniqueTable.init(h);
-   _computedTable.init(c);
-
-   // This must be called first
-   BddNode::setBddMgr(this);
-   BddNodeInt::_terminal = uniquify(0, 0, 0);
-   BddNode::_one = BddNode(BddNodeInt::_terminal, BDD_POS_EDGE);
-   BddNode::_zero = BddNode(BddNodeInt::_terminal, BDD_NEG_EDGE);
+   // BDD_LEVEL_MAX is the level of the zombies (see bddReorder.cpp)
+   assert(nin < BDD_LEVEL_MAX);
+   _uniqueTable = new BddHash[nin+1];
+   for (size_t i = 0; i <= nin; ++i)
+      _uniqueTable[i].init(h / (nin+1));
+   _computedTable.init(c, BDD_CACHE_MAX_SIZE);
+   if (_numThreads > 0) initParTables();
 
+   // The nodes are built with this BddMgr current (see below)
+   // ==> This must be called first
+   _nodePool.setTag(this);
+   setCurrent(this);
+   size_t t = uniquify(0, 0, 0);
+   // The _refCount of the terminal sticks at BDD_REF_MAX
+   // ==> BddNode::_one/_zero (one pair per thread) need no references
+   BddNodeInt::getNode(t)->_refCount = BDD_REF_MAX;
+   --_numDead;
    _supports.reserve(nin+1);
-   _supports.push_back(BddNode::_one);
+   _supports.push_back(BddNode(t));
+   setCurrent(this);
+
+   // The depth of the ite recursion is at most (nin + 1)
+   _iteStack.reserve(nin + 2);
+
    for (size_t i = 1; i <= nin; ++i)
       _supports.push_back(BddNode(BddNode::_one(), BddNode::_zero(), i));
+
+   // Variable i is at level i
+   _var2Level.resize(nin+1);
+   _level2Var.resize(nin+1);
+   for (size_t i = 0; i <= nin; ++i)
+      _var2Level[i] = _level2Var[i] = i;
+   _reorderTrigger = BDD_REORDER_MIN_NODES;
+
+   // Don't take over the thread from another BddMgr
+   if (prev && prev != this) setCurrent(prev);
+   else makeCurrent();
+}
+
+void
+BddMgr::makeCurrent()
+{
+   assert(!_supports.empty());
+   dropCurrent(this);
+   if (_numCurrMgrs == _capCurrMgrs) {
+      _capCurrMgrs = _capCurrMgrs? 2 * _capCurrMgrs : 4;
+      _currMgrs = (BddMgr**)realloc(_currMgrs,
+                                    _capCurrMgrs * sizeof(BddMgr*));
+      assert(_currMgrs != 0);
+   }
+   _currMgrs[_numCurrMgrs++] = this;
+   setCurrent(this);
+}
+
+// Remove m from _currMgrs, if there
+void
+BddMgr::dropCurrent(BddMgr* m)
+{
+   unsigned j = 0;
+   for (unsigned i = 0; i < _numCurrMgrs; ++i)
+      if (_currMgrs[i] != m) _currMgrs[j++] = _currMgrs[i];
+   _numCurrMgrs = j;
+   if (j == 0 && _currMgrs) {
+      free(_currMgrs);
+      _currMgrs = 0;
+      _capCurrMgrs = 0;
+   }
+}
+
+// A store for a new traversal (see BddNodeMarks)
+// ==> a new stamp; the stamps are cleared only when it wraps around
+BddMarkStore*
+BddMgr::getMarkStore()
+{
+   BddMarkStore* s = 0;
+   {
+      lock_guard<mutex> lock(_markLock);
+      if (!_markStores.empty()) {
+         s = _markStores.back();
+         _markStores.pop_back();
+      }
+   }
+   if (!s) s = new BddMarkStore;
+   s->restart();
+   return s;
+}
+
+void
+BddMgr::putMarkStore(BddMarkStore* s)
+{
+   lock_guard<mutex> lock(_markLock);
+   _markStores.push_back(s);
+}
+
+// Point the thread_local handles of BddNode and BddNodeInt to m (or to
+// none if m = 0), without changing _currMgrs
+// [Note] _one/_zero are set as raw values; the terminals are never
+//        referenced (see init())
+void
+BddMgr::setCurrent(BddMgr* m)
+{
+   BddNode::setBddMgr(m);
+   BddNodeInt::_nodePool = m? &m->_nodePool : 0;
+   size_t t = (m && !m->_supports.empty())? m->_supports[0]() : 0;
+   BddNodeInt::_terminal = BddNodeInt::getNode(t);
+   BddNode::_one._node = t;
+   BddNode::_zero._node = t? (t ^ BDD_NEG_EDGE) : 0;
+#ifdef BDD_COMPACT_NODE
+   BddNode::_one._pool = BddNode::_zero._pool = BddNodeInt::_nodePool;
+#endif
 }
 
 // Called by the CIRSETVar command
@@ -74,7 +176,9 @@ void
 BddMgr::restart()
 {
    size_t nin = _supports.size() - 1;
-   size_t h   = _uniqueTable.numBuckets();
+   size_t h   = 0;
+   for (size_t i = 0; i <= nin; ++i)
+      h += _uniqueTable[i].numBuckets();
    size_t c   = _computedTable.size();
 
    init(nin, h, c);
@@ -85,20 +189,52 @@ void
 BddMgr::reset()
 {
    // TODO
+   // The BddNodes below must be released with this BddMgr current
+   BddMgr* prev = BddNode::getBddMgr();
+   if (!_supports.empty()) setCurrent(this);
    _supports.clear();
    _bddArr.clear();
    _bddMap.clear();
-   BddHash::iterator bi = _uniqueTable.begin();
-   for (; bi != _uniqueTable.end(); ++bi)
-      delete (*bi).second;
-   _uniqueTable.reset();
+   // Give the thread back to the previous BddMgr before the nodes of
+   // this one are gone
+   dropCurrent(this);
+   if (prev == this || prev == 0)
+      prev = _numCurrMgrs? _currMgrs[_numCurrMgrs - 1] : 0;
+   setCurrent(prev);
+   // No need to delete the nodes one by one;
+   // ==> all the nodes are released with their chunks
+   if (_uniqueTable) { delete [] _uniqueTable; _uniqueTable = 0; }
    _computedTable.reset();
+   _parTable.reset();
+   _parHash.reset();
+   _parOverflow.reset();
+   _nodePool.reset();
+   _numDead = 0;
+   _gcRecords.clear();
+   for (size_t i = 0, n = _markStores.size(); i < n; ++i)
+      delete _markStores[i];
+   _markStores.clear();
+   _var2Level.clear();
+   _level2Var.clear();
+}
+
+BddNode
+BddMgr::ite(BddNode f, BddNode g, BddNode h)
+{
+   BddOpGuard guard(this);
+#ifndef BDD_COMPACT_NODE
+   if (_numThreads > 0)
+      return parIte(f(), g(), h());
+#endif
+   if (_iterativeIte)
+      return iteIter(f(), g(), h());
+   return iteRecur(f, g, h);
 }
 
 // [Note] Remeber to check "isNegEdge" when return BddNode!!!!!
 //
 BddNode
-BddMgr::ite(BddNode f, BddNode g, BddNode h)
+BddMgr::iteRecur(BddNode f, BddNode g, BddNode h)
 {
    bool isNegEdge = false;  // should only be flipped by "standardize()"
 
@@ -117,8 +253,8 @@ BddMgr::ite(BddNode f, BddNode g, BddNode h)
    // TODO: based on your definition of BddCacheKey,
    //       instantiate a BddCacheKey k (i.e. pass in proper data members)
    // BddCacheKey k;  // Change this line!!
-   BddCacheKey k(f(), g(), h());
-   size_t ret_t;
+   BddCacheKey k(BDD_OP_ITE, f(), g(), h());
+   BddEdge ret_t;
    if (_computedTable.read(k, ret_t)) {
       if (isNegEdge) ret_t = ret_t ^ BDD_NEG_EDGE;
       return ret_t;
@@ -132,15 +268,16 @@ BddMgr::ite(BddNode f, BddNode g, BddNode h)
       v = h.getLevel();
 
    // recursion
-   BddNode fl = f.getLeftCofactor(v),
-           gl = g.getLeftCofactor(v),
-           hl = h.getLeftCofactor(v);
-   BddNode t = ite(fl, gl, hl);
+   // ==> v is the top level, so the cofactors are just child reads
+   BddNode fl = topCofactor(f, v, true),
+           gl = topCofactor(g, v, true),
+           hl = topCofactor(h, v, true);
+   BddNode t = iteRecur(fl, gl, hl);
 
-   BddNode fr = f.getRightCofactor(v),
-           gr = g.getRightCofactor(v),
-           hr = h.getRightCofactor(v);
-   BddNode e = ite(fr, gr, hr);
+   BddNode fr = topCofactor(f, v, false),
+           gr = topCofactor(g, v, false),
+           hr = topCofactor(h, v, false);
+   BddNode e = iteRecur(fr, gr, hr);
 
    // get result
    if (t == e) {
@@ -161,8 +298,7 @@ BddMgr::ite(BddNode f, BddNode g, BddNode h)
 #endif
 
    // check unique table
-   BddNodeInt* ni = uniquify(t(), e(), v);
-   ret_t = size_t(ni);
+   ret_t = uniquify(t(), e(), v);
 #if !(DO_STD_ITE)
    if (moveBubble) ret_t = ret_t ^ BDD_NEG_EDGE;
 #endif
@@ -173,6 +309,570 @@ BddMgr::ite(BddNode f, BddNode g, BddNode h)
    return ret_t;
 }
 
+// Same algorithm as iteRecur(), but the recursion is unrolled onto
+// _iteStack, and all the nodes are raw node values.
+// [Note] The new nodes have _refCount = 0 until the returned value is
+//        referenced by the caller ==> must be called within a BddOpGuard
+//
+size_t
+BddMgr::iteIter(size_t f, size_t g, size_t h)
+{
+   size_t ret = 0;  // result of the last finished frame
+   _iteStack.clear();
+   _iteStack.push_back(IteFrame(f, g, h));
+   while (!_iteStack.empty()) {
+      IteFrame& fr = _iteStack.back();
+      if (fr._state == 0) {
+         standardize(fr._f, fr._g, fr._h, fr._isNegEdge);
+         BddEdge ret_t;
+         if (checkIteTerminal(fr._f, fr._g, fr._h, ret))
+            ;
+         else if (_computedTable.read(
+                  BddCacheKey(BDD_OP_ITE, fr._f, fr._g, fr._h), ret_t))
+            ret = ret_t;
+         else {
+            unsigned v = edgeLevel(fr._f);
+            if (edgeLevel(fr._g) > v) v = edgeLevel(fr._g);
+            if (edgeLevel(fr._h) > v) v = edgeLevel(fr._h);
+            fr._v = v;
+            fr._state = 1;
+            assert(_iteStack.size() < _iteStack.capacity());
+            _iteStack.push_back(IteFrame(edgeCofactor(fr._f, v, true),
+               edgeCofactor(fr._g, v, true), edgeCofactor(fr._h, v, true)));
+            continue;
+         }
+      }
+      else if (fr._state == 1) {
+         fr._t = ret;
+         fr._state = 2;
+         unsigned v = fr._v;
+         assert(_iteStack.size() < _iteStack.capacity());
+         _iteStack.push_back(IteFrame(edgeCofactor(fr._f, v, false),
+            edgeCofactor(fr._g, v, false), edgeCofactor(fr._h, v, false)));
+         continue;
+      }
+      else {
+         // ret is the result of the right cofactors
+         if (fr._t != ret) {
+            assert(!(fr._t & BDD_NEG_EDGE));
+            ret = uniquify(fr._t, ret, fr._v);
+         }
+         _computedTable.write(BddCacheKey(BDD_OP_ITE, fr._f, fr._g, fr._h),
+                              ret);
+      }
+      if (fr._isNegEdge) ret ^= BDD_NEG_EDGE;
+      _iteStack.pop_back();
+   }
+   return ret;
+}
+
+BddNode
+BddMgr::bddAnd(const BddNode& f, const BddNode& g)
+{
+   BddOpGuard guard(this);
+#ifndef BDD_COMPACT_NODE
+   if (_numThreads > 0)
+      return parIte(f(), g(), BddNode::_zero());
+#endif
+   return andRecur(f, g);
+}
+
+BddNode
+BddMgr::bddXor(const BddNode& f, const BddNode& g)
+{
+   BddOpGuard guard(this);
+#ifndef BDD_COMPACT_NODE
+   if (_numThreads > 0)
+      return parIte(f(), (~g)(), g());
+#endif
+   return xorRecur(f, g);
+}
+
+BddNode
+BddMgr::andRecur(BddNode f, BddNode g)
+{
+   // check terminal cases
+   if (f == g || g == BddNode::_one) return f;
+   if (f == BddNode::_one) return g;
+   if (f == ~g || f == BddNode::_zero || g == BddNode::_zero)
+      return BddNode::_zero;
+
+   // AND is commutative ==> normalize the key
+   if (f() > g()) swapBddNode(f, g);
+   BddCacheKey k(BDD_OP_AND, f(), g(), 0);
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   unsigned v = f.getLevel();
+   if (g.getLevel() > v) v = g.getLevel();
+   BddNode t = andRecur(topCofactor(f, v, true), topCofactor(g, v, true));
+   BddNode e = andRecur(topCofactor(f, v, false), topCofactor(g, v, false));
+   BddNode ret = getNode(t(), e(), v);
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+BddNode
+BddMgr::xorRecur(BddNode f, BddNode g)
+{
+   // check terminal cases
+   if (f == g) return BddNode::_zero;
+   if (f == ~g) return BddNode::_one;
+   if (f == BddNode::_zero) return g;
+   if (g == BddNode::_zero) return f;
+   if (f == BddNode::_one) return ~g;
+   if (g == BddNode::_one) return ~f;
+
+   // f ^ ~g = ~f ^ g = ~(f ^ g)
+   // ==> both f and g will be posEdge for the key
+   bool isNegEdge = false;
+   if (f.isNegEdge()) { f = ~f; isNegEdge = !isNegEdge; }
+   if (g.isNegEdge()) { g = ~g; isNegEdge = !isNegEdge; }
+   if (f() > g()) swapBddNode(f, g);
+   BddCacheKey k(BDD_OP_XOR, f(), g(), 0);
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return isNegEdge? (ret_t ^ BDD_NEG_EDGE) : ret_t;
+
+   unsigned v = f.getLevel();
+   if (g.getLevel() > v) v = g.getLevel();
+   BddNode t = xorRecur(topCofactor(f, v, true), topCofactor(g, v, true));
+   BddNode e = xorRecur(topCofactor(f, v, false), topCofactor(g, v, false));
+   BddNode ret = getNode(t(), e(), v);
+
+   _computedTable.write(k, ret());
+   return isNegEdge? ~ret : ret;
+}
+
+BddNode
+BddMgr::bddExists(const BddNode& f, const BddNode& cube)
+{
+   BddOpGuard guard(this);
+   return quantifyRecur(BDD_OP_EXIST, f, cube);
+}
+
+BddNode
+BddMgr::bddUnique(const BddNode& f, const BddNode& cube)
+{
+   BddOpGuard guard(this);
+   return quantifyRecur(BDD_OP_UNIQUE, f, cube);
+}
+
+// op = BDD_OP_EXIST or BDD_OP_UNIQUE
+// ==> The results are stored in _computedTable with key (op, f, c), so
+//     they can be reused by the later calls with the same cube
+BddNode
+BddMgr::quantifyRecur(BDD_OP_TAG op, BddNode f, BddNode c)
+{
+   unsigned v = f.getLevel();
+   if (c.getLevel() > v) {
+      // f does not depend on the top variable of c
+      // ==> f XOR f = 0 for unique quantification
+      if (op == BDD_OP_UNIQUE) return BddNode::_zero;
+      if (v == 0) return f;
+      do c = getCubeNext(c); while (c.getLevel() > v);
+   }
+   if (c == BddNode::_one) return f;
+   // ~f1 XOR ~f0 = f1 XOR f0
+   if (op == BDD_OP_UNIQUE && f.isNegEdge()) f = ~f;
+
+   BddCacheKey k(op, f(), c(), 0);
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   BddNode ret;
+   BddNode fl = f.getLeftCofactor(v), fr = f.getRightCofactor(v);
+   if (c.getLevel() == v) {
+      BddNode cn = getCubeNext(c);
+      BddNode t = quantifyRecur(op, fl, cn);
+      if (op == BDD_OP_EXIST)
+         ret = (t == BddNode::_one)? t :
+               ~andRecur(~t, ~quantifyRecur(op, fr, cn));
+      else
+         ret = xorRecur(t, quantifyRecur(op, fr, cn));
+   }
+   else {
+      BddNode t = quantifyRecur(op, fl, c);
+      BddNode e = quantifyRecur(op, fr, c);
+      ret = getNode(t(), e(), v);
+   }
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+BddNode
+BddMgr::bddAndExists(const BddNode& f, const BddNode& g, const BddNode& cube)
+{
+   BddOpGuard guard(this);
+   return andExistsRecur(f, g, cube);
+}
+
+// Same recursion as andRecur(), but the variables in c are quantified
+// out on the way back ==> f & g is never built
+BddNode
+BddMgr::andExistsRecur(BddNode f, BddNode g, BddNode c)
+{
+   // check terminal cases
+   if (f == ~g || f == BddNode::_zero || g == BddNode::_zero)
+      return BddNode::_zero;
+   if (f == g || g == BddNode::_one)
+      return quantifyRecur(BDD_OP_EXIST, f, c);
+   if (f == BddNode::_one)
+      return quantifyRecur(BDD_OP_EXIST, g, c);
+
+   unsigned v = f.getLevel();
+   if (g.getLevel() > v) v = g.getLevel();
+   while (c.getLevel() > v) c = getCubeNext(c);
+   if (c == BddNode::_one) return andRecur(f, g);
+
+   // AND is commutative ==> normalize the key
+   if (f() > g()) swapBddNode(f, g);
+   BddCacheKey k(BDD_OP_AND_EXIST, f(), g(), c());
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   BddNode ret;
+   BddNode fl = f.getLeftCofactor(v), fr = f.getRightCofactor(v),
+           gl = g.getLeftCofactor(v), gr = g.getRightCofactor(v);
+   if (c.getLevel() == v) {
+      BddNode cn = getCubeNext(c);
+      BddNode t = andExistsRecur(fl, gl, cn);
+      ret = (t == BddNode::_one)? t :
+            ~andRecur(~t, ~andExistsRecur(fr, gr, cn));
+   }
+   else {
+      BddNode t = andExistsRecur(fl, gl, c);
+      BddNode e = andExistsRecur(fr, gr, c);
+      ret = getNode(t(), e(), v);
+   }
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+BddNode
+BddMgr::compose(const BddNode& f, unsigned v, const BddNode& g)
+{
+   assert(v > 0 && v < _supports.size());
+   BddOpGuard guard(this);
+   return composeRecur(f, _var2Level[v], g);
+}
+
+// Substitute g for the variable at level l
+// ==> The results are cached with key (f, g, the support at level l)
+BddNode
+BddMgr::composeRecur(BddNode f, unsigned l, const BddNode& g)
+{
+   unsigned v = f.getLevel();
+   if (v < l) return f;
+   // compose(~f) = ~compose(f)
+   if (f.isNegEdge()) return ~composeRecur(~f, l, g);
+
+   BddCacheKey k(BDD_OP_COMPOSE, f(), g(), _supports[_level2Var[l]]());
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   BddNode fl = f.getLeftCofactor(v), fr = f.getRightCofactor(v);
+   BddNode ret;
+   if (v == l)
+      ret = iteRecur(g, fl, fr);
+   else {
+      // g may depend on the variables above v
+      // ==> cannot just call getNode()
+      BddNode t = composeRecur(fl, l, g);
+      BddNode e = composeRecur(fr, l, g);
+      ret = iteRecur(_supports[_level2Var[v]], t, e);
+   }
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+BddNode
+BddMgr::vecCompose(const BddNode& f, const vector<BddNode>& gs)
+{
+   assert(gs.size() == _supports.size());
+   // The guard may reorder ==> minLevel must be taken after it
+   BddOpGuard guard(this);
+   // The nodes below minLevel are not changed
+   unsigned minLevel = _supports.size();
+   for (size_t i = 1, n = gs.size(); i < n; ++i)
+      if (gs[i]() != 0 && gs[i] != _supports[i] &&
+          _var2Level[i] < minLevel)
+         minLevel = _var2Level[i];
+
+   BddNodeMemo<size_t> memo;
+   return vecComposeRecur(f, minLevel, gs, memo);
+}
+
+// The results depend on gs ==> memoized in memo, not _computedTable
+size_t
+BddMgr::vecComposeRecur(const BddNode& f, unsigned minLevel,
+   const vector<BddNode>& gs, BddNodeMemo<size_t>& memo)
+{
+   unsigned v = f.getLevel();
+   if (v < minLevel) return f();
+   if (f.isNegEdge())
+      return vecComposeRecur(~f, minLevel, gs, memo) ^ BDD_NEG_EDGE;
+
+   const size_t* mp = memo.find(f());
+   if (mp) return *mp;
+
+   BddNode t = vecComposeRecur(f.getLeftCofactor(v), minLevel, gs, memo);
+   BddNode e = vecComposeRecur(f.getRightCofactor(v), minLevel, gs, memo);
+   unsigned i = _level2Var[v];
+   BddNode ret = iteRecur(gs[i]() != 0? gs[i] : _supports[i], t, e);
+   memo.insert(f(), ret());
+   return ret();
+}
+
+BddNode
+BddMgr::constrain(const BddNode& f, const BddNode& c)
+{
+   BddOpGuard guard(this);
+   return constrainRecur(f, c);
+}
+
+BddNode
+BddMgr::restrict(const BddNode& f, const BddNode& c)
+{
+   BddOpGuard guard(this);
+   return restrictRecur(f, c);
+}
+
+BddNode
+BddMgr::constrainRecur(BddNode f, BddNode c)
+{
+   // check terminal cases
+   if (c == BddNode::_zero) return BddNode::_zero;
+   if (c == BddNode::_one || f.getLevel() == 0) return f;
+   if (f == c) return BddNode::_one;
+   if (f == ~c) return BddNode::_zero;
+   // constrain(~f, c) = ~constrain(f, c)
+   if (f.isNegEdge()) return ~constrainRecur(~f, c);
+
+   BddCacheKey k(BDD_OP_CONSTRAIN, f(), c(), 0);
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   unsigned v = f.getLevel();
+   if (c.getLevel() > v) v = c.getLevel();
+   BddNode cl = c.getLeftCofactor(v), cr = c.getRightCofactor(v);
+   BddNode ret;
+   if (cl == BddNode::_zero)
+      ret = constrainRecur(f.getRightCofactor(v), cr);
+   else if (cr == BddNode::_zero)
+      ret = constrainRecur(f.getLeftCofactor(v), cl);
+   else {
+      BddNode t = constrainRecur(f.getLeftCofactor(v), cl);
+      BddNode e = constrainRecur(f.getRightCofactor(v), cr);
+      ret = getNode(t(), e(), v);
+   }
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+// Same as constrainRecur(), but the variables of c that are above f are
+// quantified out of c (instead of being brought into the result)
+BddNode
+BddMgr::restrictRecur(BddNode f, BddNode c)
+{
+   // check terminal cases
+   if (c == BddNode::_zero) return BddNode::_zero;
+   if (c == BddNode::_one || f.getLevel() == 0) return f;
+   if (f == c) return BddNode::_one;
+   if (f == ~c) return BddNode::_zero;
+   // restrict(~f, c) = ~restrict(f, c)
+   if (f.isNegEdge()) return ~restrictRecur(~f, c);
+
+   BddCacheKey k(BDD_OP_RESTRICT, f(), c(), 0);
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   unsigned v = f.getLevel();
+   BddNode ret;
+   if (c.getLevel() > v) {
+      unsigned cv = c.getLevel();
+      ret = restrictRecur(f, ~andRecur(~c.getLeftCofactor(cv),
+                                       ~c.getRightCofactor(cv)));
+   }
+   else {
+      BddNode cl = c.getLeftCofactor(v), cr = c.getRightCofactor(v);
+      if (cl == BddNode::_zero)
+         ret = restrictRecur(f.getRightCofactor(v), cr);
+      else if (cr == BddNode::_zero)
+         ret = restrictRecur(f.getLeftCofactor(v), cl);
+      else {
+         BddNode t = restrictRecur(f.getLeftCofactor(v), cl);
+         BddNode e = restrictRecur(f.getRightCofactor(v), cr);
+         ret = getNode(t(), e(), v);
+      }
+   }
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+BddNode
+BddMgr::cofactor(const BddNode& f, const BddNode& cube)
+{
+   BddOpGuard guard(this);
+   return cofactorRecur(f, cube);
+}
+
+// [Note] _opDepth is raised without beginOp(), so a BddOpGuard of the
+//        recursion does not check the GC and reordering either
+BddNode
+BddMgr::levelCofactor(const BddNode& f, unsigned i, bool isLeft)
+{
+   assert(isCurrent());
+   ++_opDepth;
+   const BddNode& x = getSupport(getVarOfLevel(i));
+   BddNode ret = cofactorRecur(f, isLeft? x : ~x);
+   --_opDepth;
+   return ret;
+}
+
+BddNode
+BddMgr::cofactorRecur(BddNode f, BddNode c)
+{
+   unsigned v = f.getLevel();
+   if (v == 0) return f;
+   while (c.getLevel() > v) c = getCubeNext(c);
+   if (c == BddNode::_one) return f;
+   // cofactor(~f) = ~cofactor(f)
+   if (f.isNegEdge()) return ~cofactorRecur(~f, c);
+
+   BddCacheKey k(BDD_OP_COFACTOR, f(), c(), 0);
+   BddEdge ret_t;
+   if (_computedTable.read(k, ret_t))
+      return ret_t;
+
+   BddNode ret;
+   if (c.getLevel() == v) {
+      // negative literal <==> the left (then) branch of c is 0
+      bool isLeft = (topCofactor(c, v, true) != BddNode::_zero);
+      ret = cofactorRecur(topCofactor(f, v, isLeft), getCubeNext(c));
+   }
+   else {
+      BddNode t = cofactorRecur(topCofactor(f, v, true), c);
+      BddNode e = cofactorRecur(topCofactor(f, v, false), c);
+      ret = getNode(t(), e(), v);
+   }
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+BddNode
+BddMgr::isop(const BddNode& l, const BddNode& u, vector<string>* cubes)
+{
+   BddOpGuard guard(this);
+#ifndef NDEBUG
+   set<pair<size_t, size_t> > visited;
+   assert(isLeqRecur(l(), u(), visited));
+#endif
+   string cube(_supports.size() - 1, '-');
+   return isopRecur(l, u, cube, cubes);
+}
+
+// l <= u (i.e. l & ~u = 0), by reading the nodes only
+// ==> no node or _computedTable entry is created, so the assertion of
+//     isop() leaves the same state as a -DNDEBUG build
+// [Note] A pair in visited is true, or the traversal has already ended
+bool
+BddMgr::isLeqRecur(size_t l, size_t u,
+                   set<pair<size_t, size_t> >& visited) const
+{
+   size_t one = BddNode::_one(), zero = BddNode::_zero();
+   if (l == u || l == zero || u == one) return true;
+   if (l == one || u == zero || l == (u ^ BDD_NEG_EDGE)) return false;
+   if (!visited.insert(make_pair(l, u)).second) return true;
+   unsigned v = edgeLevel(l);
+   if (edgeLevel(u) > v) v = edgeLevel(u);
+   return isLeqRecur(edgeCofactor(l, v, true), edgeCofactor(u, v, true),
+                     visited) &&
+          isLeqRecur(edgeCofactor(l, v, false), edgeCofactor(u, v, false),
+                     visited);
+}
+
+// For the top variable x, with l0/l1 (u0/u1) the cofactors of l (u),
+//    cover = ~x & isop(l0 & ~u1, u0)       ==> r0
+//          |  x & isop(l1 & ~u0, u1)       ==> r1
+//          |      isop(l0 & ~r0 | l1 & ~r1, u0 & u1)   ==> rs
+// where the first two cover the minterms that need x (~x), and the
+// last one covers the rest with the cubes without x.
+// cube is the prefix of literals on the way down.
+// [Note] The cover function is cached in _computedTable. The cubes are
+//        not ==> with cubes, the recursion is always taken (the sub-
+//        functions are still cached), and it is linear in #cubes.
+BddNode
+BddMgr::isopRecur(BddNode l, BddNode u, string& cube, vector<string>* cubes)
+{
+   // check terminal cases
+   if (l == BddNode::_zero) return BddNode::_zero;
+   if (u == BddNode::_one) {
+      if (cubes) cubes->push_back(cube);
+      return BddNode::_one;
+   }
+
+   BddCacheKey k(BDD_OP_ISOP, l(), u(), 0);
+   BddEdge ret_t;
+   if (!cubes && _computedTable.read(k, ret_t))
+      return ret_t;
+
+   unsigned v = l.getLevel();
+   if (u.getLevel() > v) v = u.getLevel();
+   BddNode l1 = topCofactor(l, v, true), l0 = topCofactor(l, v, false);
+   BddNode u1 = topCofactor(u, v, true), u0 = topCofactor(u, v, false);
+   size_t x = _level2Var[v] - 1;
+
+   cube[x] = '0';
+   BddNode r0 = isopRecur(andRecur(l0, ~u1), u0, cube, cubes);
+   cube[x] = '1';
+   BddNode r1 = isopRecur(andRecur(l1, ~u0), u1, cube, cubes);
+   cube[x] = '-';
+   BddNode ls = ~andRecur(~andRecur(l0, ~r0), ~andRecur(l1, ~r1));
+   BddNode rs = isopRecur(ls, andRecur(u0, u1), cube, cubes);
+
+   BddNode t = ~andRecur(~r1, ~rs), e = ~andRecur(~r0, ~rs);
+   BddNode ret = getNode(t(), e(), v);
+
+   _computedTable.write(k, ret());
+   return ret;
+}
+
+// Return the cube without its top variable
+BddNode
+BddMgr::getCubeNext(const BddNode& c)
+{
+   unsigned v = c.getLevel();
+   BddNode l = c.getLeftCofactor(v);
+   if (l == BddNode::_zero) return c.getRightCofactor(v);
+   assert(c.getRightCofactor(v) == BddNode::_zero);
+   return l;
+}
+
+// Return the node (v ? t : e)
+// ==> move the bubble to the output if t is a negEdge
+BddNode
+BddMgr::getNode(size_t t, size_t e, unsigned v)
+{
+   if (t == e) return t;
+   if (t & BDD_NEG_EDGE)
+      return uniquify(t ^ BDD_NEG_EDGE, e ^ BDD_NEG_EDGE, v) ^ BDD_NEG_EDGE;
+   return uniquify(t, e, v);
+}
+
 void
 BddMgr::standardize(BddNode &f, BddNode &g, BddNode &h, bool &isNegEdge)
 {
@@ -208,23 +908,191 @@ BddMgr::standardize(BddNode &f, BddNode &g, BddNode &h, bool &isNegEdge)
    }
 }
 
+// Same as standardize() above, on raw node values
+void
+BddMgr::standardize(size_t &f, size_t &g, size_t &h, bool &isNegEdge) const
+{
+   size_t one = BddNode::_one(), zero = BddNode::_zero();
+
+   // (1) Identical/Complement rules
+   if (f == g) g = one;
+   else if (f == (g ^ BDD_NEG_EDGE)) g = zero;
+   else if (f == h) h = zero;
+   else if (f == (h ^ BDD_NEG_EDGE)) h = one;
+
+   // (2) Symmetrical rules
+   if (g == one) {
+      if (edgeGreater(f, h)) swap(f, h);
+   }
+   else if (g == zero) {
+      if (edgeGreater(f, h)) {
+         swap(f, h); f ^= BDD_NEG_EDGE; h ^= BDD_NEG_EDGE; }
+   }
+   else if (h == one) {
+      if (edgeGreater(f, g)) {
+         swap(f, g); f ^= BDD_NEG_EDGE; g ^= BDD_NEG_EDGE; }
+   }
+   else if (h == zero) {
+      if (edgeGreater(f, g)) swap(f, g);
+   }
+   else if (g == (h ^ BDD_NEG_EDGE)) {
+      if (edgeGreater(f, g)) { swap(f, g); h = g ^ BDD_NEG_EDGE; }
+   }
+
+   // (3) Complement edge rules
+   // ==> both f and g will be posEdge afterwards
+   if (f & BDD_NEG_EDGE) { swap(g, h); f ^= BDD_NEG_EDGE; }
+   if (g & BDD_NEG_EDGE) {
+      g ^= BDD_NEG_EDGE; h ^= BDD_NEG_EDGE; isNegEdge = !isNegEdge;
+   }
+}
+
 // Check if triplet (l, r, i) is in _uniqueTable,
 // If not, create a new node;
 // else, return the hashed one
 //
-BddNodeInt*
+size_t
 BddMgr::uniquify(size_t l, size_t r, unsigned i)
 {
    // TODO
-   BddNodeInt* n = 0;
+   BddEdge n = 0;
+   BddHash& ht = _uniqueTable[i];
    BddHashKey k(l, r, i);
-   if (!_uniqueTable.check(k, n)) {
-      n = new BddNodeInt(l, r, i);
-      _uniqueTable.forceInsert(k, n);
+   if (!ht.check(k, n)) {
+      n = newNode(l, r, i);
+      ht.forceInsert(k, n);
    }
    return n;
 }
 
+// Allocate a new (dead) node, which is not in _uniqueTable yet
+size_t
+BddMgr::newNode(size_t l, size_t r, unsigned i)
+{
+   ++_numDead;
+#ifdef BDD_COMPACT_NODE
+   size_t idx = _nodePool.allocIndex();
+   assert(idx < (size_t(1) << 31));
+   new (_nodePool.at(idx)) BddNodeInt(l, r, i);
+   return idx << 1;
+#else
+   return size_t(new (_nodePool.alloc()) BddNodeInt(l, r, i));
+#endif
+}
+
+//----------------------------------------------------------------------
+//    Garbage collection
+//----------------------------------------------------------------------
+size_t
+BddMgr::garbageCollect()
+{
+   assert(_opDepth == 0);
+   clock_t start = clock();
+
+   // Collect the dead nodes
+   // [Note] A dead node does not reference its children
+   //        ==> no need to update the _refCount of the other nodes
+   vector<BddEdge> deadNodes;
+   deadNodes.reserve(_numDead);
+   for (size_t l = 0, nl = getNumLevels(); l < nl; ++l) {
+      BddHash::iterator bi = _uniqueTable[l].begin();
+      for (; bi != _uniqueTable[l].end(); ++bi)
+         if (isDeadEdge((*bi).second))
+            deadNodes.push_back((*bi).second);
+   }
+
+   // Purge the computed table entries that refer to the dead nodes
+   // ==> Must be done before the nodes are actually freed
+   purgeComputedTable(&BddMgr::isDeadEdge);
+
+   // Free the dead nodes
+   // ==> don't call ~BddNodeInt(); _left/_right hold no references
+   for (size_t i = 0, n = deadNodes.size(); i < n; ++i)
+      freeNode(deadNodes[i]);
+   _numDead -= deadNodes.size();
+
+   double t = double(clock() - start) / CLOCKS_PER_SEC;
+   _gcRecords.push_back(BddGcRecord(deadNodes.size(), t));
+   return deadNodes.size();
+}
+
+// Remove node e from _uniqueTable and return it to _nodePool
+void
+BddMgr::freeNode(size_t e)
+{
+   BddNodeInt* n = getNodeInt(e);
+   _uniqueTable[n->getLevel()].remove(
+      BddHashKey(n->getLeftEdge(), n->getRightEdge(), n->getLevel()));
+   recycleNode(e);
+}
+
+// Return node e, which is not in _uniqueTable, to _nodePool
+void
+BddMgr::recycleNode(size_t e)
+{
+#ifdef BDD_COMPACT_NODE
+   _nodePool.freeIndex(e >> 1);
+#else
+   _nodePool.free(getNodeInt(e));
+#endif
+}
+
+// Remove the _computedTable entries that refer to any stale node
+void
+BddMgr::purgeComputedTable(bool (BddMgr::*isStale)(size_t) const)
+{
+   for (size_t i = 0, n = _computedTable.size(); i < n; ++i) {
+      pair<BddCacheKey, BddEdge>& entry = _computedTable[i];
+      const BddCacheKey& k = entry.first;
+      if (k._op == BDD_OP_NONE) continue;
+      if ((this->*isStale)(k._f) || (this->*isStale)(k._g) ||
+          (this->*isStale)(k._h) || (this->*isStale)(entry.second)) {
+         entry.first = BddCacheKey();
+         entry.second = 0;
+      }
+   }
+   for (size_t i = 0, n = _parTable.size(); i < n; ++i) {
+      BddCacheKey& k = _parTable.key(i);
+      if (k._op == BDD_OP_NONE) continue;
+      if ((this->*isStale)(k._f) || (this->*isStale)(k._g) ||
+          (this->*isStale)(k._h) || (this->*isStale)(_parTable.data(i))) {
+         k = BddCacheKey();
+         _parTable.data(i) = 0;
+      }
+   }
+}
+
+void
+BddMgr::printGcStats(ostream& os) const
+{
+   size_t totalNodes = 0;
+   double totalTime = 0;
+   for (size_t i = 0, n = _gcRecords.size(); i < n; ++i) {
+      os << "GC #" << i << ": " << setw(10) << _gcRecords[i]._numReclaimed
+         << " nodes reclaimed in " << _gcRecords[i]._time << " sec" << endl;
+      totalNodes += _gcRecords[i]._numReclaimed;
+      totalTime += _gcRecords[i]._time;
+   }
+   os << "==> Total #GC passes : " << _gcRecords.size() << endl
+      << "    Total #reclaimed : " << totalNodes << endl
+      << "    Total GC time    : " << totalTime << " sec" << endl
+      << "    #Live nodes      : " << getNumLiveNodes()
+      << endl;
+}
+
+void
+BddMgr::printCacheStats(ostream& os) const
+{
+   os << "Computed table : " << _computedTable.size() << " entries ("
+      << ASSOC_CACHE_WAYS << "-way, max " << _computedTable.maxSize()
+      << ")" << endl
+      << "  #hits      : " << _computedTable.numHits() << endl
+      << "  #misses    : " << _computedTable.numMisses() << endl
+      << "  hit rate   : " << _computedTable.hitRate() << endl
+      << "  #evictions : " << _computedTable.numEvictions() << endl
+      << "  #resizes   : " << _computedTable.numResizes() << endl;
+}
+
 // return false if _bddArr[id] has aleady been inserted
 bool
 BddMgr::addBddNode(unsigned id, size_t n)
@@ -233,8 +1101,8 @@ BddMgr::addBddNode(unsigned id, size_t n)
       unsigned origSize = _bddArr.size();
       _bddArr.resize(id+1);
       for(unsigned i = origSize; i < _bddArr.size(); ++i)
-        _bddArr[i] = 0;
-   } else if (_bddArr[id] != 0)
+        _bddArr[i] = size_t(0);
+   } else if (_bddArr[id]() != 0)
       return false;
    _bddArr[id] = n;
    return true;
@@ -284,6 +1152,17 @@ BddMgr::checkIteTerminal
    return false;
 }
 
+// Same as above, on raw node values
+bool
+BddMgr::checkIteTerminal(size_t f, size_t g, size_t h, size_t& n) const
+{
+   if (g == h) { n = g; return true; }
+   if (f == BddNode::_one()) { n = g; return true; }
+   if (f == BddNode::_zero()) { n = h; return true; }
+   if (g == BddNode::_one() && h == BddNode::_zero()) { n = f; return true; }
+   return false;
+}
+
 //----------------------------------------------------------------------
 //    Application functions
 //----------------------------------------------------------------------
@@ -295,33 +1174,92 @@ int
 BddMgr::evalCube(const BddNode& node, const string& pattern) const
 {
    // TODO
-   size_t v = node.getLevel();
+   size_t l = node.getLevel();
    size_t n = pattern.size();
-   if (n < v) {
-      cerr << "Error: " << pattern << " too short!!" << endl;
-      return -1;
-   }
+   for (size_t i = 1; i <= l; ++i)
+      if (n < _level2Var[i]) {
+         cerr << "Error: " << pattern << " too short!!" << endl;
+         return -1;
+      }
 
    BddNode next = node;
-   for (int i = v - 1; i >= 0; --i) {
-      char c = pattern[i];
+   for (size_t i = l; i > 0; --i) {
+      size_t v = _level2Var[i] - 1;
+      char c = pattern[v];
       if (c == '1')
-         next = next.getLeftCofactor(i+1);
+         next = next.getLeftCofactor(i);
       else if (c == '0')
-         next = next.getRightCofactor(i+1);
+         next = next.getRightCofactor(i);
       else {
-         cerr << "Illegal pattern: " << c << "(" << i << ")" << endl;
+         cerr << "Illegal pattern: " << c << "(" << v << ")" << endl;
          return -1;
       }
    }
    return (next == BddNode::_one)? 1 : 0;
 }
 
+void
+BddMgr::evalBatch(const BddNode& f, const vector<unsigned long long>& words,
+                  size_t nw, vector<unsigned long long>& res) const
+{
+   assert(words.size() == _supports.size() * nw);
+   // vals[0 ~ nw-1] is the const 1
+   vector<unsigned long long> vals(nw, ~0ULL);
+   BddNodeMemo<size_t> memo;
+   size_t i = evalBatchRecur(f(), &words[0], nw, memo, vals);
+   unsigned long long neg = f.isNegEdge()? ~0ULL : 0;
+   res.resize(nw);
+   for (size_t w = 0; w < nw; ++w)
+      res[w] = vals[i + w] ^ neg;
+}
+
+unsigned long long
+BddMgr::evalBatch(const BddNode& f,
+                  const vector<unsigned long long>& words) const
+{
+   vector<unsigned long long> res;
+   evalBatch(f, words, 1, res);
+   return res[0];
+}
+
+// Return the offset of the values of the node of e in vals, where
+//    f = (x & f|x=1) | (~x & f|x=0)
+// is computed bitwise, with the complement edges as ~
+size_t
+BddMgr::evalBatchRecur(size_t e, const unsigned long long* words,
+                       size_t nw, BddNodeMemo<size_t>& memo,
+                       vector<unsigned long long>& vals) const
+{
+   BddNodeInt* n = getNodeInt(e);
+   if (n == getTerminal()) return 0;
+   size_t p = e & ~size_t(BDD_NEG_EDGE);
+   const size_t* ip = memo.find(p);
+   if (ip) return *ip;
+
+   size_t l = n->getLeftEdge(), r = n->getRightEdge();
+   size_t t = evalBatchRecur(l, words, nw, memo, vals);
+   size_t f = evalBatchRecur(r, words, nw, memo, vals);
+   size_t i = vals.size();
+   vals.resize(i + nw);
+   const unsigned long long* x = words + _level2Var[n->getLevel()] * nw;
+   const unsigned long long* tv = &vals[t];
+   const unsigned long long* fv = &vals[f];
+   unsigned long long* v = &vals[i];
+   // the left (then) edge is always a posEdge
+   unsigned long long neg = (r & BDD_NEG_EDGE)? ~0ULL : 0;
+   for (size_t w = 0; w < nw; ++w)
+      v[w] = (x[w] & tv[w]) | (~x[w] & (fv[w] ^ neg));
+   memo.insert(p, i);
+   return i;
+}
+
 bool
 BddMgr::drawBdd(const string& name, const string& fileName) const
 {
    // TODO
-   BddNode node = ::getBddNode(name);
+   int id;
+   BddNode node = myStr2Int(name, id)?  // name is an ID
+                  getBddNode(unsigned(id)) : getBddNode(name);
    if (node() == 0) {
       cerr << "Error: \"" << name << "\" is not a legal BDD node!!" << endl;
       return false;
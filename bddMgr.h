@@ -10,85 +10,471 @@
 #define BDD_MGR_H
 
 #include <map>
+#include <set>
+#include <vector>
+#include <cassert>
+#include <climits>
+#include <ctime>
+#include <random>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 #include "myHash.h"
+#include "myPool.h"
+#include "myBigNum.h"
 #include "bddNode.h"
 
 using namespace std;
 
 class BddNode;
+struct BddCompiledNode;
 
-typedef vector<size_t>                        BddArr;
-typedef map<string, size_t>                   BddMap;
-typedef pair<string, size_t>                  BddMapPair;
-typedef map<string, size_t>::const_iterator   BddMapConstIter;
+// BddNode (instead of size_t) is stored so that the BDDs in _bddArr and
+// _bddMap are referenced, and thus protected from garbage collection
+typedef vector<BddNode>                       BddArr;
+typedef map<string, BddNode>                  BddMap;
+typedef pair<string, BddNode>                 BddMapPair;
+typedef map<string, BddNode>::const_iterator  BddMapConstIter;
 
-extern BddMgr* bddMgr;
+#define BDD_CACHE_MAX_SIZE  (1 << 20)
+// The chunk size of _nodePool; also for BddNodeInt::getOwner() to find
+// the chunk head (see Pool::tagOf())
+#define BDD_POOL_CHUNK_SIZE  POOL_CHUNK_SIZE
+// Automatic reordering is triggered when #live nodes reaches
+// max(2 * #live nodes after the last reordering, BDD_REORDER_MIN_NODES)
+#define BDD_REORDER_MIN_NODES  4096
+// The max #branches in the deque of a thread of the parallel ite; a
+// power of 2 (see BddMgr::ParWorker)
+#define BDD_PAR_DEQUE_SIZE  64
 
 class BddHashKey
 {
 public:
    // TODO: define constructor(s)
-   BddHashKey(size_t l, size_t r, unsigned i) : _l(l), _r(r), _i(i) {}
+   BddHashKey() {}
+   BddHashKey(BddEdge l, BddEdge r, unsigned i) : _l(l), _r(r), _i(i) {}
 
    // TODO: implement "()" and "==" operators
    // Get a size_t number;
-   // ==> to get bucket number, need to % _numBuckers in Hash
-   size_t operator() () const { return ((_l << 3) + (_r << 3) + _i); }
+   // ==> the low bits are used as the slot number in OpenHash,
+   //     so all of _l, _r and _i need to be well mixed
+   size_t operator() () const {
+      size_t h = size_t(_l) * 0x9e3779b97f4a7c15ULL;
+      h ^= (_r + (h >> 29)) * 0xbf58476d1ce4e5b9ULL;
+      h ^= (_i + (h >> 32)) * 0x94d049bb133111ebULL;
+      return h ^ (h >> 31);
+   }
 
-   bool operator == (const BddHashKey& k) {
+   bool operator == (const BddHashKey& k) const {
       return (_l == k._l) && (_r == k._r) && (_i == k._i); }
 
 private:
    // TODO: define your own data members
-   size_t     _l;
-   size_t     _r;
+   BddEdge    _l;
+   BddEdge    _r;
    unsigned   _i;
 };
 
+// The BddHashKey of a node (i.e. its positive edge) in BddParHash
+struct BddNodeHashKeyOf
+{
+   BddHashKey operator () (size_t e) const {
+      const BddNodeInt* n = BddNodeInt::getNode(e);
+      return BddHashKey(n->getLeftEdge(), n->getRightEdge(), n->getLevel());
+   }
+};
+
+// Key of a node (i.e. its positive edge) in a BddNodeMemo
+class BddNodeKey
+{
+public:
+   BddNodeKey() : _e(0) {}
+   BddNodeKey(size_t e) : _e(e) {}
+
+   size_t operator() () const {
+      size_t h = _e * 0x9e3779b97f4a7c15ULL;
+      return h ^ (h >> 31);
+   }
+   bool operator == (const BddNodeKey& k) const { return (_e == k._e); }
+
+private:
+   size_t     _e;
+};
+
+// A flat memo (i.e. no allocation per entry, as in std::map) from the
+// nodes to the values of type T, for one traversal of a BDD
+template <class T>
+class BddNodeMemo
+{
+public:
+   BddNodeMemo(size_t n = 256) : _index(n) { _values.reserve(n); }
+
+   // return 0 if e is not in the memo
+   // [Note] The pointer is invalidated by the next insert()
+   const T* find(size_t e) const {
+      size_t i;
+      return _index.check(BddNodeKey(e), i)? &_values[i - 1] : 0;
+   }
+   // e must not be in the memo yet
+   const T& insert(size_t e, const T& v) {
+      _values.push_back(v);
+      _index.forceInsert(BddNodeKey(e), _values.size());
+      return _values.back();
+   }
+   size_t size() const { return _values.size(); }
+   void clear() { _index.init(_values.capacity()); _values.clear(); }
+
+private:
+   OpenHash<BddNodeKey, size_t>   _index;   // to (index in _values) + 1
+   vector<T>                      _values;
+};
+
+// The visited marks of the traversals of a BDD, kept aside from the nodes
+// ==> an open-addressing set (linear probing) of the node indices
+//     reached, where a slot is taken only if it has the stamp of the
+//     current traversal; a new stamp per traversal, so there is no pass
+//     to clear the marks
+// ==> sized by the nodes reached (at most half full), not by the node
+//     pool; so a traversal of a small BDD takes little memory
+// A BddMarkStore is reused by the traversals of a BddMgr, one at a time.
+struct BddMarkStore
+{
+   BddMarkStore() : _stamp(0), _numMarks(0) {}
+
+   // Mark node index i; return false if it has been marked
+   bool mark(unsigned i) {
+      if (2 * (_numMarks + 1) > _slots.size()) grow();
+      size_t mask = _slots.size() - 1;
+      for (size_t h = slotOf(i); ; h = (h + 1) & mask) {
+         pair<unsigned, unsigned>& s = _slots[h];
+         if (s.second != _stamp) {
+            s.first = i; s.second = _stamp; ++_numMarks;
+            return true;
+         }
+         if (s.first == i) return false;
+      }
+   }
+   // A new traversal
+   void restart() {
+      _numMarks = 0;
+      if (++_stamp != 0) return;
+      for (size_t j = 0, n = _slots.size(); j < n; ++j) _slots[j].second = 0;
+      _stamp = 1;
+   }
+
+   vector<pair<unsigned, unsigned> >  _slots;   // (node index, stamp)
+   unsigned          _stamp;     // of the current traversal
+   size_t            _numMarks;  // by the current traversal
+
+private:
+   size_t slotOf(unsigned i) const {
+      return size_t((i * 0x9e3779b97f4a7c15ULL) >> 32) & (_slots.size() - 1);
+   }
+   // Double the slots (64 at first), with the marks of this traversal
+   void grow() {
+      vector<pair<unsigned, unsigned> > old;
+      old.swap(_slots);
+      _slots.resize(old.empty()? 64 : 2 * old.size(), make_pair(0u, 0u));
+      _numMarks = 0;
+      for (size_t j = 0, n = old.size(); j < n; ++j)
+         if (old[j].second == _stamp) mark(old[j].first);
+   }
+};
+
+// The marks of one traversal from the node of root, in a
+// BddMarkStore borrowed from its BddMgr (see BddMgr::getMarkStore())
+// [Note] Without BDD_COMPACT_NODE, the traversals (e.g. printing and
+//        drawing) write nothing to the nodes, and each one has a store of
+//        its own; so several threads can run them on one BddMgr at once
+//        (see BddMgr::makeCurrent())
+class BddNodeMarks
+{
+public:
+   BddNodeMarks(const BddNode& root);
+   ~BddNodeMarks();
+
+   // Mark the node of e; return false if it has been marked
+   bool mark(size_t e);
+
+private:
+   BddMgr*         _mgr;
+   BddMarkStore*   _store;
+
+   // BddNodeMarks is not copyable
+   BddNodeMarks(const BddNodeMarks&);
+   BddNodeMarks& operator = (const BddNodeMarks&);
+};
+
+// (P(f), P(~f)); see BddMgr::probability()
+typedef pair<long double, long double>        BddProb;
+
+// Tag of the operation that produces a _computedTable entry
+// ==> different operators can share the same _computedTable
+enum BDD_OP_TAG
+{
+   BDD_OP_NONE = 0,   // empty entry
+   BDD_OP_ITE  = 1,
+   BDD_OP_AND  = 2,
+   BDD_OP_XOR  = 3,
+   BDD_OP_EXIST  = 4,
+   BDD_OP_UNIQUE = 5,
+   BDD_OP_AND_EXIST = 6,
+   BDD_OP_COMPOSE   = 7,
+   BDD_OP_CONSTRAIN = 8,
+   BDD_OP_RESTRICT  = 9,
+   BDD_OP_COFACTOR  = 10,
+   BDD_OP_ISOP      = 11,
+
+   BDD_OP_DUMMY  // dummy end
+};
+
 class BddCacheKey
 {
+   friend class BddMgr;
+
 public:
    // TODO: define constructor(s)
-   BddCacheKey() {}
-   BddCacheKey(size_t f, size_t g, size_t h) : _f(f), _g(g), _h(h) {}
+   // BddCacheKey() denotes an empty entry
+   BddCacheKey() : _f(0), _g(0), _h(0), _op(BDD_OP_NONE) {}
+   BddCacheKey(BDD_OP_TAG op, BddEdge f, BddEdge g, BddEdge h)
+   : _f(f), _g(g), _h(h), _op(op) {}
 
    // TODO: implement "()" and "==" operators
    // Get a size_t number;
-   // ==> to get cache address, need to % _size in Cache
-   size_t operator() () const { return ((_f << 3)+(_g << 3)+(_h << 3)); }
+   // ==> the low bits are used as the set number in AssocCache,
+   //     so (f, g, h) and (g, f, h) should not collide
+   size_t operator() () const {
+      size_t k = (size_t(_f) + _op) * 0x9e3779b97f4a7c15ULL;
+      k ^= (_g + (k >> 29)) * 0xbf58476d1ce4e5b9ULL;
+      k ^= (_h + (k >> 32)) * 0x94d049bb133111ebULL;
+      return k ^ (k >> 31);
+   }
 
    bool operator == (const BddCacheKey& k) const {
-      return (_f == k._f) && (_g == k._g) && (_h == k._h); }
+      return (_f == k._f) && (_g == k._g) && (_h == k._h) && (_op == k._op); }
 
 private:
    // TODO: define your own data members
-   size_t       _f;
-   size_t       _g;
-   size_t       _h;
+   BddEdge      _f;
+   BddEdge      _g;
+   BddEdge      _h;
+   BDD_OP_TAG   _op;
+};
+
+// Statistics of one garbage collection pass
+struct BddGcRecord
+{
+   BddGcRecord(size_t n, double t) : _numReclaimed(n), _time(t) {}
+
+   size_t      _numReclaimed;
+   double      _time;          // in seconds
 };
 
 class BddMgr
 {
-typedef Hash<BddHashKey, BddNodeInt*> BddHash;
-typedef Cache<BddCacheKey, size_t>    BddCache;
+// Both tables store the (positive) edges of the nodes
+// _uniqueTable is split into one BddHash (subtable) per level
+typedef OpenHash<BddHashKey, BddEdge>     BddHash;
+typedef AssocCache<BddCacheKey, BddEdge>  BddCache;
+typedef LossyCache<BddCacheKey, BddEdge>  BddParCache;
+typedef LockFreeHash<BddHashKey, BddNodeHashKeyOf>  BddParHash;
+typedef Pool<BddNodeInt>                  BddPool;
+
+friend class BddNodeInt;
+friend class BddNodeMarks;
+friend class BddSampler;
+friend class BddCompiled;
+friend class BddCubeIter;
 
 public:
+   typedef BddHash::iterator  BddLevelIter;
+
+   // h is the initial #slots of _uniqueTable, shared by all the levels;
+   // every subtable grows on its own.
+   // c is the initial #entries of _computedTable; it can grow to
+   // max(c, BDD_CACHE_MAX_SIZE) entries (see setCacheMaxSize())
    BddMgr(size_t nin = 64, size_t h = 8009, size_t c = 30011)
+   : _uniqueTable(0), _nodePool(BDD_POOL_CHUNK_SIZE), _numDead(0), _numThreads(0),
+     _forkDepth(0), _parWorkers(0), _numQueued(0), _numIdle(0),
+     _stopWorkers(false), _iterativeIte(false), _opDepth(0),
+     _gcThreshold(1 << 16), _autoReorder(false), _reorderMaxGrowth(1.2),
+     _reorderTimeLimit(0), _reorderTrigger(BDD_REORDER_MIN_NODES),
+     _numReorders(0)
    { init(nin, h, c); }
-   ~BddMgr() { reset(); }
+   ~BddMgr() { setNumThreads(0); reset(); }
 
    void init(size_t nin, size_t h, size_t c);
    void restart();
+   // The BddNode functions (e.g. &, ~, copy and destruction) work on the
+   // current BddMgr of the thread, which is the last one made current in
+   // the thread (see BddNode::getBddMgr())
+   // ==> A new BddMgr becomes current only if there is none; destroying
+   //     the current BddMgr makes the previous one current again
+   // ==> Each thread can run its own BddMgr. A BddMgr can also be shared
+   //     by the threads one at a time, or several BddMgrs by one thread;
+   //     but the BddNodes of a BddMgr must only be created while it is
+   //     current. They can be copied and destroyed at any time, as a node
+   //     finds its own BddMgr (see BddNodeInt::getOwner()); in
+   //     BDD_COMPACT_NODE mode, a BddNode also keeps the node pool of its
+   //     BddMgr (see BddNode::_pool), while a raw edge (i.e. a node
+   //     index) is only resolved by the node pool of the current BddMgr
+   // ==> Likewise, the functions that only read the nodes (e.g.
+   //     BddCubeIter, BddSampler, BddCompiled, satCount(), evalBatch())
+   //     and garbageCollect() work on a BddMgr that is not current
+   // [Note] A BddMgr must be destroyed in the last thread that made it
+   //        current; the other ones must have ended
+   void makeCurrent();
+   bool isCurrent() const { return BddNode::_BddMgr == this; }
 
    // for building BDDs
    BddNode ite(BddNode f, BddNode g, BddNode h);
+   // ite() by recursion (default) or by the iterative engine, which runs
+   // on an explicit, preallocated stack (_iteStack) and raw node values
+   void setIterativeIte(bool b) { _iterativeIte = b; }
+   bool isIterativeIte() const { return _iterativeIte; }
+   // n = 0 (default): the serial engines above
+   // n > 0: ite(), bddAnd() and bddXor() (and thus bddOr() etc. and the
+   //        operators &, |, ^ of BddNode) run on the parallel engine,
+   //        whose branches are forked, down to depth (log2(n) + 1), to
+   //        the deques of n threads (the calling one and (n - 1)
+   //        workers), which steal from each other; the new nodes are
+   //        inserted to a lock-free table (_parHash), and moved to
+   //        _uniqueTable when the operation ends; the node pool is
+   //        refilled in batches, and the computed table (_parTable) is
+   //        lossy and non-blocking (see bddPar.cpp)
+   //        ==> n = 1 runs the same engine without forking
+   // [Note] The other operations (e.g. exist(), compose()) stay serial
+   // [Note] Not in BDD_COMPACT_NODE mode, where the node pool may move
+   //        under the readers ==> n > 0 is rejected with a warning, and
+   //        getNumThreads() stays 0
+   void setNumThreads(unsigned n);
+   unsigned getNumThreads() const { return _numThreads; }
+   // Binary apply; the same results as ite(), but faster
+   BddNode bddAnd(const BddNode& f, const BddNode& g);
+   BddNode bddOr(const BddNode& f, const BddNode& g) {
+      return ~bddAnd(~f, ~g); }
+   BddNode bddNand(const BddNode& f, const BddNode& g) {
+      return ~bddAnd(f, g); }
+   BddNode bddXor(const BddNode& f, const BddNode& g);
+   BddNode bddXnor(const BddNode& f, const BddNode& g) {
+      return ~bddXor(f, g); }
+   // Quantify the variables in cube (e.g. x1 & x3 & x4) out of f
+   // [Note] cube must be a conjunction of literals; their phases are
+   //        ignored (i.e. x1 & ~x3 is the same as x1 & x3)
+   // ==> exists: f|v=1 OR f|v=0; forall: AND; unique: XOR
+   BddNode bddExists(const BddNode& f, const BddNode& cube);
+   BddNode bddForall(const BddNode& f, const BddNode& cube) {
+      return ~bddExists(~f, cube); }
+   BddNode bddUnique(const BddNode& f, const BddNode& cube);
+   // Relational product: bddExists(f & g, cube), but without building
+   // f & g (e.g. for image computation)
+   BddNode bddAndExists(const BddNode& f, const BddNode& g,
+                        const BddNode& cube);
+   // Substitute g for variable v (i.e. getSupport(v)) in f
+   BddNode compose(const BddNode& f, unsigned v, const BddNode& g);
+   // Substitute gs[i] for every variable i in f simultaneously
+   // ==> gs is indexed as _supports (gs[0] is not used); a null BddNode
+   //     (i.e. BddNode()) means "no substitution" for that variable
+   BddNode vecCompose(const BddNode& f, const vector<BddNode>& gs);
+   // Generalized cofactors (Coudert-Madre); c is the care set
+   // ==> both agree with f wherever c = 1; return 0 if c = 0
+   // constrain(f, c) & c = f & c, and is an image-preserving map
+   // restrict(f, c) does not introduce the variables that are not in f,
+   // and is usually smaller
+   BddNode constrain(const BddNode& f, const BddNode& c);
+   BddNode restrict(const BddNode& f, const BddNode& c);
+   // Cofactor f w.r.t. a cube of literals (e.g. x1 & ~x3)
+   // ==> variable v is set to 1 (0) if v (~v) is in cube
+   BddNode cofactor(const BddNode& f, const BddNode& cube);
+   // cofactor() by the variable at level i (of the positive or negative
+   // phase), for BddNode::getLeftCofactor() and getRightCofactor()
+   // ==> runs within the current operation, if any, and never starts
+   //     garbage collection or reordering (unlike BddOpGuard); so i and
+   //     the raw node values of the caller stay valid across the call
+   BddNode levelCofactor(const BddNode& f, unsigned i, bool isLeft);
+   // Irredundant sum-of-products (Minato-Morreale) of any function in the
+   // interval [l, u] (l <= u), e.g. isop(f, f) or isop(f & ~dc, f | dc)
+   // ==> return the function of the cover, which is in [l, u]
+   // ==> the cubes are appended to cubes, if given, as the patterns of
+   //     BddCubeIter (i.e. '1', '0' or '-' for each variable)
+   BddNode isop(const BddNode& l, const BddNode& u, vector<string>* cubes = 0);
+
+   // Automatic garbage collection and reordering can only happen at the
+   // beginning of the outermost BDD operation. Any function that keeps raw
+   // node values (i.e. size_t), or walks through a BDD, across BDD
+   // operations should be bracketed by beginOp()/endOp() (see BddOpGuard).
+   void beginOp() {
+      assert(isCurrent());
+      if (_opDepth == 0) { checkGc(); checkReorder(); }
+      ++_opDepth; }
+   void endOp() { assert(_opDepth > 0); --_opDepth; }
+
+   // for garbage collection
+   // Free the nodes whose _refCount = 0, and purge the _computedTable
+   // entries that refer to them. Return the number of reclaimed nodes.
+   size_t garbageCollect();
+   // GC is triggered when #dead nodes >= threshold; 0 to disable
+   void setGcThreshold(size_t t) { _gcThreshold = t; }
+   size_t getGcThreshold() const { return _gcThreshold; }
+   size_t getNumDeadNodes() const { return _numDead; }
+   const vector<BddGcRecord>& getGcRecords() const { return _gcRecords; }
+   void printGcStats(ostream& os) const;
+
+   // for _computedTable
+   void setCacheMaxSize(size_t m) { _computedTable.setMaxSize(m); }
+   size_t getCacheSize() const { return _computedTable.size(); }
+   size_t getCacheHits() const { return _computedTable.numHits(); }
+   size_t getCacheMisses() const { return _computedTable.numMisses(); }
+   size_t getCacheEvictions() const { return _computedTable.numEvictions(); }
+   void printCacheStats(ostream& os) const;
 
    // for _supports
    const BddNode& getSupport(size_t i) const { return _supports[i]; }
    size_t getNumSupports() const { return _supports.size(); }
 
+   // for variable ordering
+   // Variable i (i.e. getSupport(i)) is at level getLevelOfVar(i), which
+   // is i until the variables are reordered.
+   // [Note] The functions of BddNode that take an unsigned (e.g.
+   //        getLeftCofactor(), exist(), nodeMove()) refer to levels
+   unsigned getLevelOfVar(unsigned v) const { return _var2Level[v]; }
+   unsigned getVarOfLevel(unsigned l) const { return _level2Var[l]; }
+   // Swap the variables at levels l and l+1 in place
+   // ==> all the BddNode handles remain valid (and keep their functions)
+   void swapLevels(unsigned l);
+   // Sift every variable to its best level (Rudell's sifting)
+   // Return #live nodes afterwards
+   size_t reorder();
+   // Reorder when #live nodes doubles since the last reordering
+   void setAutoReorder(bool b) { _autoReorder = b; }
+   bool isAutoReorder() const { return _autoReorder; }
+   // A variable stops moving in one direction if #live nodes exceeds
+   // g * (the best size so far)
+   void setReorderMaxGrowth(double g) {
+      assert(g >= 1); _reorderMaxGrowth = g; }
+   // in seconds; 0 for no limit
+   void setReorderTimeLimit(double t) { _reorderTimeLimit = t; }
+   // #reorder() and swapLevels() calls so far
+   size_t getNumReorders() const { return _numReorders; }
+
    // for _uniqueTable
-   BddNodeInt* uniquify(size_t l, size_t r, unsigned i);
+   // return the (positive) edge of the node
+   size_t uniquify(size_t l, size_t r, unsigned i);
+   // Go through the nodes at level l by
+   //    for (BddLevelIter li = levelBegin(l); li != levelEnd(l); ++li)
+   //       ... (*li).second ...  // the (positive) edge of a node
+   // [Note] The dead nodes (i.e. not yet garbage collected) are included,
+   //        and so are they in getLevelSize()
+   BddLevelIter levelBegin(unsigned l) const {
+      return _uniqueTable[l].begin(); }
+   BddLevelIter levelEnd(unsigned l) const { return _uniqueTable[l].end(); }
+   size_t getLevelSize(unsigned l) const { return _uniqueTable[l].size(); }
+   // #levels, including level 0 (the terminal)
+   size_t getNumLevels() const { return _supports.size(); }
+   size_t getNumNodes() const { return _nodePool.size(); }
+   size_t getNumLiveNodes() const {
+      return _nodePool.size() - _numDead - _zombies.size(); }
 
    // for _bddArr: access by unsigned (ID)
    bool addBddNode(unsigned id, size_t nodeV);
@@ -99,25 +485,354 @@ public:
    void forceAddBddNode(const string& nodeName, size_t nodeV);
    BddNode getBddNode(const string& nodeName) const;
 
+   // Model counting (see bddCount.cpp)
+   // #minterms of f over the variables at levels 1 ~ nvars
+   // [Note] nvars must be >= f.getLevel()
+   // ==> satCount() is in long double; inf if #minterms >= 2^16384
+   // ==> satCountLog2() = log2(satCount()), computed on log2 of the
+   //     densities, so it neither overflows nor underflows for any
+   //     nvars; -inf if f = 0
+   // ==> satCountExact() is exact, in arbitrary precision
+   long double satCount(const BddNode& f, unsigned nvars) const;
+   long double satCountLog2(const BddNode& f, unsigned nvars) const;
+   BigNum satCountExact(const BddNode& f, unsigned nvars) const;
+   // Probability of f = 1, where the variables are independent and
+   // probs[i] = P(variable i = 1) (probs is indexed as _supports)
+   double probability(const BddNode& f, const vector<double>& probs) const;
+   // The same for all the BDDs in fs, in one traversal
+   // ==> res[i] = probability(fs[i], probs)
+   void probability(const vector<BddNode>& fs, const vector<double>& probs,
+                    vector<double>& res) const;
+
    // Applications
    int evalCube(const BddNode& node, const string& vector) const;
+   // Evaluate f on (64 * nw) patterns at once, in one traversal of f
+   // ==> bit j of words[i * nw + w] is variable i of pattern (64w + j)
+   //     (words is indexed as _supports, i.e. words[0 ~ nw-1] unused)
+   // ==> bit j of res[w] is f(pattern (64w + j))
+   // [Note] No node is created; the loops over the nw words are
+   //        vectorized by the compiler
+   void evalBatch(const BddNode& f, const vector<unsigned long long>& words,
+                  size_t nw, vector<unsigned long long>& res) const;
+   unsigned long long evalBatch(const BddNode& f,
+                                const vector<unsigned long long>& words) const;
    bool drawBdd(const string& nodeName, const string& dotFile) const;
 
 private:
+   // A branch forked by parIteRecur(); it is run by the forking thread
+   // itself, or by the thread that steals it (see bddPar.cpp)
+   struct ParTask
+   {
+      ParTask(size_t f, size_t g, size_t h, unsigned d)
+      : _f(f), _g(g), _h(h), _depth(d), _ret(0), _isDone(false) {}
+
+      size_t       _f;
+      size_t       _g;
+      size_t       _h;
+      unsigned     _depth;
+      size_t       _ret;        // set before _isDone
+      atomic<bool> _isDone;
+   };
+
+   // The per-thread state of the parallel ite (_parWorkers[_parId])
+   struct ParWorker
+   {
+      ParWorker() : _top(0), _bottom(0) {}
+
+      // The forked branches not taken yet, in a Chase-Lev deque of
+      // [_top, _bottom): the forking thread pushes and pops its own at
+      // the bottom, the others steal from the top (the largest) by a CAS
+      // ==> no lock; a full deque takes no more forks
+      bool push(ParTask* task);
+      ParTask* pop();
+      ParTask* steal();
+      atomic<long long>    _top;
+      atomic<long long>    _bottom;
+      atomic<ParTask*>     _tasks[BDD_PAR_DEQUE_SIZE];
+      // Allocated from _nodePool, not used yet
+      vector<BddNodeInt*>  _spares;
+      // The nodes created (i.e. to be added to _numDead and _uniqueTable),
+      // and the slots of _parHash taken by them
+      vector<size_t>       _newNodes;
+      vector<size_t>       _newSlots;
+   };
+
+   // A pending ite(_f, _g, _h) call in _iteStack
+   // _state: 0 ==> to check the terminal cases and _computedTable
+   //         1 ==> waiting for the result of the left (then) cofactors
+   //         2 ==> waiting for the result of the right (else) cofactors
+   struct IteFrame
+   {
+      IteFrame(size_t f, size_t g, size_t h)
+      : _f(f), _g(g), _h(h), _t(0), _v(0), _isNegEdge(false), _state(0) {}
+
+      size_t       _f;
+      size_t       _g;
+      size_t       _h;
+      size_t       _t;
+      unsigned     _v;
+      bool         _isNegEdge;
+      unsigned     _state;
+   };
+
    // level = 0: const 1;
    // level = 1: lowest input variable
    // level = nin: highest input variable
    vector<BddNode>  _supports;
-   BddHash          _uniqueTable;
+   BddHash*         _uniqueTable;   // [0 ~ nin]
    BddCache         _computedTable;
+   BddPool          _nodePool;
+   // #nodes with _refCount = 0 (i.e. to be garbage collected)
+   size_t           _numDead;
+
+   // for the parallel ite
+   BddParHash       _parHash;       // the new nodes
+   BddHash          _parOverflow;   // those not taken by _parHash
+   mutex            _overflowLock;  // for _parOverflow
+   mutex            _poolLock;      // for _nodePool
+   BddParCache      _parTable;
+   unsigned         _numThreads;
+   unsigned         _forkDepth;
+   vector<thread>   _workers;
+   ParWorker*       _parWorkers;    // [0 ~ _numThreads - 1]
+   atomic<size_t>   _numQueued;     // #tasks in all the deques
+   // The idle workers, and the threads waiting for a stolen task, sleep
+   // on _idleCv (see backOff())
+   atomic<unsigned> _numIdle;
+   mutex            _idleLock;      // for _stopWorkers
+   condition_variable  _idleCv;
+   bool             _stopWorkers;
+   // 0 for the thread calling ite(); 1 ~ (n - 1) for the workers
+   static thread_local unsigned  _parId;
 
    BddArr           _bddArr;
    BddMap           _bddMap;
 
+   // for the iterative ite
+   bool             _iterativeIte;
+   vector<IteFrame> _iteStack;
+
+   // for BddNodeMarks; the stores not in use
+   vector<BddMarkStore*>  _markStores;
+   mutex                  _markLock;
+
+   // for garbage collection
+   unsigned             _opDepth;
+   size_t               _gcThreshold;
+   vector<BddGcRecord>  _gcRecords;
+
+   // for variable reordering
+   vector<unsigned>     _var2Level;
+   vector<unsigned>     _level2Var;
+   bool                 _autoReorder;
+   double               _reorderMaxGrowth;
+   double               _reorderTimeLimit;
+   size_t               _reorderTrigger;
+   size_t               _numReorders;
+   // The nodes whose _refCount drops to 0 during reordering
+   vector<size_t>       _zombies;
+
+   // The BddMgrs made current in this thread, the current one last
+   // ==> grown on demand, and freed when empty
+   // [Note] Not a vector, which could be destroyed at exit before the
+   //        global BddMgrs
+   static thread_local BddMgr**  _currMgrs;
+   static thread_local unsigned  _numCurrMgrs;
+   static thread_local unsigned  _capCurrMgrs;
+
    void reset();
+   static void setCurrent(BddMgr* m);
+   static void dropCurrent(BddMgr* m);
+   BddMarkStore* getMarkStore();
+   void putMarkStore(BddMarkStore* s);
+   // The BddNodeInt of an edge of this BddMgr, current or not
+   BddNodeInt* getNodeInt(size_t e) const {
+#ifdef BDD_COMPACT_NODE
+      return e? _nodePool.at(e >> 1) : 0;
+#else
+      return BddNodeInt::getNode(e);
+#endif
+   }
+   BddNodeInt* getTerminal() const { return getNodeInt(_supports[0]()); }
+   // The BddMgr of the node of f, current or not
+   static BddMgr* ownerOf(const BddNode& f) {
+      return f.getBddNodeInt()->getOwner(); }
+   BddNode iteRecur(BddNode f, BddNode g, BddNode h);
+   BddNode andRecur(BddNode f, BddNode g);
+   BddNode xorRecur(BddNode f, BddNode g);
+   BddNode quantifyRecur(BDD_OP_TAG op, BddNode f, BddNode c);
+   BddNode andExistsRecur(BddNode f, BddNode g, BddNode c);
+   BddNode composeRecur(BddNode f, unsigned l, const BddNode& g);
+   BddNode constrainRecur(BddNode f, BddNode c);
+   BddNode restrictRecur(BddNode f, BddNode c);
+   BddNode cofactorRecur(BddNode f, BddNode c);
+   bool isLeqRecur(size_t l, size_t u,
+                   set<pair<size_t, size_t> >& visited) const;
+   BddNode isopRecur(BddNode l, BddNode u, string& cube,
+                     vector<string>* cubes);
+   size_t vecComposeRecur(const BddNode& f, unsigned minLevel,
+                          const vector<BddNode>& gs,
+                          BddNodeMemo<size_t>& memo);
+   static BddNode getCubeNext(const BddNode& c);
+   BddNode getNode(size_t t, size_t e, unsigned v);
    bool checkIteTerminal(const BddNode&, const BddNode&, const BddNode&,
                          BddNode&);
    void standardize(BddNode &f, BddNode &g, BddNode &h, bool &isNegEdge);
+   size_t iteIter(size_t f, size_t g, size_t h);
+   size_t parIte(size_t f, size_t g, size_t h);
+   size_t parIteRecur(size_t f, size_t g, size_t h, unsigned depth);
+   void initParTables();
+   void startWorkers(unsigned n);
+   void stopWorkers();
+   void workerLoop(unsigned id);
+   bool forkTask(ParTask* task);
+   ParTask* popTask(unsigned id);
+   ParTask* stealTask(unsigned id);
+   size_t joinTask(ParTask* task);
+   void runTask(ParTask* task);
+   bool backOff(unsigned& round, ParTask* task);
+   size_t parUniquify(size_t l, size_t r, unsigned i);
+   size_t newNode(size_t l, size_t r, unsigned i);
+   bool checkIteTerminal(size_t f, size_t g, size_t h, size_t& n) const;
+   void standardize(size_t &f, size_t &g, size_t &h, bool &isNegEdge) const;
+   void checkGc() {
+      if (_gcThreshold && _numDead >= _gcThreshold)
+         garbageCollect();
+   }
+   void freeNode(size_t e);
+   size_t evalBatchRecur(size_t e, const unsigned long long* words,
+                         size_t nw, BddNodeMemo<size_t>& memo,
+                         vector<unsigned long long>& vals) const;
+   // for BddCompiled::compile()
+   unsigned compileRecur(size_t e, BddNodeMemo<unsigned>& memo,
+                         vector<BddCompiledNode>& nodes) const;
+   // for model counting
+   BddProb probRecur(size_t e, const vector<double>* probs,
+                     BddNodeMemo<BddProb>& memo) const;
+   BddProb logProbRecur(size_t e, BddNodeMemo<BddProb>& memo) const;
+   BigNum satCountRecur(size_t e, BddNodeMemo<BigNum>& memo) const;
+   long double getProb(size_t e, const BddNodeMemo<BddProb>& memo) const;
+   void sampleMinterm(size_t e, const BddNodeMemo<BddProb>& memo,
+                      mt19937_64& rng, vector<bool>& bits) const;
+   void recycleNode(size_t e);
+   void purgeComputedTable(bool (BddMgr::*isStale)(size_t) const);
+
+   // for variable reordering (see bddReorder.cpp)
+   void checkReorder() {
+      if (_autoReorder && getNumLiveNodes() >= _reorderTrigger) reorder();
+   }
+   void beginReorder();
+   void endReorder();
+   void siftVar(unsigned v, clock_t start);
+   void swapInPlace(unsigned l);
+   void takeLevel(unsigned l, vector<size_t>& nodes);
+   size_t refNode(size_t t, size_t e, unsigned l);
+   void derefNode(size_t e);
+   bool isReorderTimeout(clock_t start) const {
+      return _reorderTimeLimit > 0 &&
+         double(clock() - start) / CLOCKS_PER_SEC > _reorderTimeLimit;
+   }
+
+   // Functions on raw node values (i.e. BddNode::_node)
+   // ==> no BddNode temporaries, and thus no _refCount traffic
+   static unsigned edgeLevel(size_t e) {
+      return BddNodeInt::getNode(e)->getLevel(); }
+   // Same as BddNode::operator >
+   static bool edgeGreater(size_t a, size_t b) {
+      unsigned la = edgeLevel(a), lb = edgeLevel(b);
+      return (la > lb) || ((la == lb) && (a > b));
+   }
+   // Same as BddNode::getLeftCofactor(v) / getRightCofactor(v),
+   // but v must be >= the level of e
+   // ==> the cofactors of the top variable are just child reads
+   static size_t edgeCofactor(size_t e, unsigned v, bool isLeft) {
+      BddNodeInt* n = BddNodeInt::getNode(e);
+      if (n->getLevel() != v) return e;
+      return (isLeft? n->getLeftEdge() : n->getRightEdge()) ^
+             (e & BDD_NEG_EDGE);
+   }
+   static BddNode topCofactor(const BddNode& f, unsigned v, bool isLeft) {
+      return edgeCofactor(f(), v, isLeft); }
+   // for garbage collection, on this BddMgr, current or not
+   bool isDeadEdge(size_t e) const {
+      return e && getNodeInt(e)->getRefCount() == 0;
+   }
+   bool isZombieEdge(size_t e) const {
+      return e && getNodeInt(e)->getLevel() == BDD_LEVEL_MAX;
+   }
 };
 
+// Keep the BddMgr busy (i.e. no automatic GC) within the scope
+class BddOpGuard
+{
+public:
+   BddOpGuard(BddMgr* m) : _mgr(m) { _mgr->beginOp(); }
+   ~BddOpGuard() { _mgr->endOp(); }
+
+private:
+   BddMgr*     _mgr;
+};
+
+// Draw the minterms of f uniformly at random, in the BddMgr of f
+// ==> The minterm densities of the nodes are computed once in the
+//     constructor; then each sample() takes O(#levels + #variables)
+// [Note] f is referenced, so it is safe across garbage collection. The
+//        densities are recomputed by the next sample() after the
+//        variables are reordered.
+// [Note] The densities are in long double, as satCount(), and underflow
+//        to 0 for a BDD of more than about 16000 levels
+//        ==> f must have a density >= 2^-16445 (asserted)
+class BddSampler
+{
+public:
+   BddSampler(const BddNode& f, unsigned long long seed = 0);
+
+   void setSeed(unsigned long long seed) { _rng.seed(seed); }
+   // bits[i] = the value of variable i (bits is indexed as _supports)
+   // ==> return false (and bits is untouched) if f = 0
+   bool sample(vector<bool>& bits);
+   // Draw n minterms; return #minterms drawn (i.e. n, or 0 if f = 0)
+   size_t sample(size_t n, vector<vector<bool> >& samples);
+
+private:
+   BddMgr*                 _mgr;
+   BddNode                 _root;
+   size_t                  _numReorders;
+   BddNodeMemo<BddProb>    _memo;
+   mt19937_64              _rng;
+
+   void computeDensities();
+};
+
+//----------------------------------------------------------------------
+//    inline functions of BddNodeMarks
+//----------------------------------------------------------------------
+inline
+BddNodeMarks::BddNodeMarks(const BddNode& root)
+: _mgr(BddMgr::ownerOf(root)), _store(_mgr->getMarkStore())
+{}
+
+inline
+BddNodeMarks::~BddNodeMarks()
+{
+   _mgr->putMarkStore(_store);
+}
+
+inline bool
+BddNodeMarks::mark(size_t e)
+{
+#ifdef BDD_COMPACT_NODE
+   size_t i = e >> 1;
+#else
+   size_t i = _mgr->_nodePool.indexOf(BddNodeInt::getNode(e));
+#endif
+   assert(i <= UINT_MAX);
+   return _store->mark(unsigned(i));
+}
+
+// Look up a BDD by its ID or name in the current BddMgr
+// ==> for the code written for the former global "BddMgr* bddMgr", which
+//     is now BddNode::getBddMgr()
+BddNode getBddNode(const string& bddName);
+
 #endif // BDD_MGR_H
@@ -15,26 +15,34 @@
 
 // Initialize static data members
 //
-BddMgr* BddNode::_BddMgr = 0;
-BddNodeInt* BddNodeInt::_terminal = 0;
-BddNode BddNode::_one;
-BddNode BddNode::_zero;
+thread_local BddMgr* BddNode::_BddMgr = 0;
+thread_local BddNodeInt* BddNodeInt::_terminal = 0;
+thread_local Pool<BddNodeInt>* BddNodeInt::_nodePool = 0;
+thread_local BddNode BddNode::_one;
+thread_local BddNode BddNode::_zero;
 bool BddNode::_debugBddAddr = false;
 bool BddNode::_debugRefCount = false;
 
 // We check the hash when a new BddNodeInt is possibly being created
 BddNode::BddNode(size_t l, size_t r, size_t i, BDD_EDGE_FLAG f)
 {
-   BddNodeInt* n = _BddMgr->uniquify(l, r, i);
+   size_t n = _BddMgr->uniquify(l, r, i);
    // n should not = 0
    assert(n != 0);
-   _node = size_t(n) + f;
-   n->incRefCount();
+   _node = n + f;
+#ifdef BDD_COMPACT_NODE
+   _pool = BddNodeInt::_nodePool;
+#endif
+   getBddNodeInt()->incRefCount();
 }
 
 // Copy constructor also needs to increase the _refCount
 // Need to check if n._node != 0
+#ifdef BDD_COMPACT_NODE
+BddNode::BddNode(const BddNode& n) : _node(n._node), _pool(n._pool)
+#else
 BddNode::BddNode(const BddNode& n) : _node(n._node)
+#endif
 {
    BddNodeInt* t = getBddNodeInt();
    if (t)
@@ -47,12 +55,22 @@ BddNode::BddNode(BddNodeInt* n, BDD_EDGE_FLAG f)
 {
    assert(n != 0);
    // TODO
+#ifdef BDD_COMPACT_NODE
+   _pool = BddNodeInt::_nodePool;
+   _node = (_pool->indexOf(n) << 1) + f;
+#else
    _node = size_t(n) + f;
+#endif
    n->incRefCount();
 }
 
 // Need to check if n._node != 0
+// [Note] v is an edge of the current BddMgr
+#ifdef BDD_COMPACT_NODE
+BddNode::BddNode(size_t v) : _node(v), _pool(BddNodeInt::_nodePool)
+#else
 BddNode::BddNode(size_t v) : _node(v)
+#endif
 {
    // TODO
    BddNodeInt* n = getBddNodeInt();
@@ -60,6 +78,16 @@ BddNode::BddNode(size_t v) : _node(v)
       n->incRefCount();
 }
 
+#ifdef BDD_COMPACT_NODE
+// v is an edge of the BddMgr of node pool p, current or not
+BddNode::BddNode(size_t v, Pool<BddNodeInt>* p) : _node(v), _pool(p)
+{
+   BddNodeInt* n = getBddNodeInt();
+   if (n)
+      n->incRefCount();
+}
+#endif
+
 // Need to check if _node != 0
 BddNode::~BddNode()
 {
@@ -69,18 +97,63 @@ BddNode::~BddNode()
       n->decRefCount();
 }
 
-const BddNode&
+// A node becomes dead when its _refCount drops to 0
+// ==> it no longer references its children,
+//     and the children may become dead too
+// ==> charged to its own BddMgr, which may not be the current one
+void
+BddNodeInt::kill()
+{
+   BddMgr* m = getOwner();
+   ++m->_numDead;
+   BddNodeInt* n = m->getNodeInt(getLeftEdge());
+   if (n) n->decRefCount();
+   n = m->getNodeInt(getRightEdge());
+   if (n) n->decRefCount();
+}
+
+// A dead node (not yet garbage collected) is referenced again
+// (e.g. hit in the unique or computed table)
+void
+BddNodeInt::revive()
+{
+   BddMgr* m = getOwner();
+   --m->_numDead;
+   BddNodeInt* n = m->getNodeInt(getLeftEdge());
+   if (n) n->incRefCount();
+   n = m->getNodeInt(getRightEdge());
+   if (n) n->incRefCount();
+}
+
+// The node pool of a BddMgr is tagged with the BddMgr
+BddMgr*
+BddNodeInt::getOwner() const
+{
+   return (BddMgr*)Pool<BddNodeInt>::tagOf(this, BDD_POOL_CHUNK_SIZE);
+}
+
+BddChild
 BddNode::getLeft() const
 {
    assert(getBddNodeInt() != 0);
+#ifdef BDD_COMPACT_NODE
+   // in the node pool of this BddNode, which need not be the current one
+   return BddNode(getBddNodeInt()->getLeftEdge(), _pool);
+#else
    return getBddNodeInt()->getLeft();
+#endif
 }
 
-const BddNode&
+BddChild
 BddNode::getRight() const
 {
    assert(getBddNodeInt() != 0);
+#ifdef BDD_COMPACT_NODE
+   // in the node pool of this BddNode, which need not be the current one
+   return BddNode(getBddNodeInt()->getRightEdge(), _pool);
+#else
    return getBddNodeInt()->getRight();
+#endif
 }
 
 // [Note] i SHOULD NOT < getLevel()
@@ -93,13 +166,9 @@ BddNode::getLeftCofactor(unsigned i) const
    if (i > getLevel()) return (*this);
    if (i == getLevel())
       return isNegEdge()? ~getLeft() : getLeft();
-   BddNode t = getLeft().getLeftCofactor(i);
-   BddNode e = getRight().getLeftCofactor(i);
-   if (t == e) return isNegEdge()? ~t : t;
-   BDD_EDGE_FLAG f = (isNegEdge() ^ t.isNegEdge())?
-                      BDD_NEG_EDGE: BDD_POS_EDGE;
-   if (t.isNegEdge()) { t = ~t; e = ~e; }
-   return BddNode(t(), e(), getLevel(), f);
+   // i is below the top level ==> memoized cofactor, with no GC or
+   // reordering (see BddMgr::levelCofactor())
+   return _BddMgr->levelCofactor(*this, i, true);
 }
 
 // [Note] i SHOULD NOT < getLevel()
@@ -112,13 +181,9 @@ BddNode::getRightCofactor(unsigned i) const
    if (i > getLevel()) return (*this);
    if (i == getLevel())
       return isNegEdge()? ~getRight() : getRight();
-   BddNode t = getLeft().getRightCofactor(i);
-   BddNode e = getRight().getRightCofactor(i);
-   if (t == e) return isNegEdge()? ~t : t;
-   BDD_EDGE_FLAG f = (isNegEdge() ^ t.isNegEdge())?
-                      BDD_NEG_EDGE: BDD_POS_EDGE;
-   if (t.isNegEdge()) { t = ~t; e = ~e; }
-   return BddNode(t(), e(), getLevel(), f);
+   // i is below the top level ==> memoized cofactor, with no GC or
+   // reordering (see BddMgr::levelCofactor())
+   return _BddMgr->levelCofactor(*this, i, false);
 }
 
 unsigned
@@ -144,6 +209,9 @@ BddNode::operator = (const BddNode& n)
    if (t)
       t->decRefCount();
    _node = n._node;
+#ifdef BDD_COMPACT_NODE
+   _pool = n._pool;
+#endif
    t = getBddNodeInt();
    if (t)
       t->incRefCount();
@@ -154,7 +222,7 @@ BddNode
 BddNode::operator & (const BddNode& n) const
 {
    // TODO
-   return _BddMgr->ite((*this), n, BddNode::_zero);
+   return _BddMgr->bddAnd((*this), n);
 }
 
 BddNode&
@@ -169,7 +237,7 @@ BddNode
 BddNode::operator | (const BddNode& n) const
 {
    // TODO
-   return _BddMgr->ite((*this), BddNode::_one, n);
+   return _BddMgr->bddOr((*this), n);
 }
 
 BddNode&
@@ -184,7 +252,7 @@ BddNode
 BddNode::operator ^ (const BddNode& n) const
 {
    // TODO
-   return _BddMgr->ite((*this), ~n, n);
+   return _BddMgr->bddXor((*this), n);
 }
 
 BddNode&
@@ -232,46 +300,44 @@ BddNode::isTerminal() const
 BddNode
 BddNode::exist(unsigned l) const
 {
-   if (l == 0) return (*this);
+   if (l == 0 || l > getLevel()) return (*this);
+   return exists(_BddMgr->getSupport(_BddMgr->getVarOfLevel(l)));
+}
 
-   map<size_t, size_t> existMap;
-   return existRecur(l, existMap);
+BddNode
+BddNode::exists(const BddNode& cube) const
+{
+   return _BddMgr->bddExists(*this, cube);
 }
 
 BddNode
-BddNode::existRecur(unsigned l, map<size_t, size_t>& existMap) const
+BddNode::forall(const BddNode& cube) const
 {
-   if (isTerminal()) return (*this);
+   return _BddMgr->bddForall(*this, cube);
+}
 
-   unsigned thisLevel = getLevel();
-   if (l > thisLevel) return (*this);
+BddNode
+BddNode::unique(const BddNode& cube) const
+{
+   return _BddMgr->bddUnique(*this, cube);
+}
 
-   map<size_t, size_t>::iterator mi = existMap.find(_node);
-   if (mi != existMap.end()) return (*mi).second;
+BddNode
+BddNode::compose(unsigned v, const BddNode& g) const
+{
+   return _BddMgr->compose(*this, v, g);
+}
 
-   BddNode left = getLeftCofactor(thisLevel);
-   BddNode right = getRightCofactor(thisLevel);
-   if (l == thisLevel) {
-      BddNode res = left | right;
-      existMap[_node] = res();
-      return res;
-   }
+BddNode
+BddNode::constrain(const BddNode& c) const
+{
+   return _BddMgr->constrain(*this, c);
+}
 
-   // l must < getLevel()
-   bool isNegEdge = false;
-   BddNode t = left.existRecur(l, existMap);
-   BddNode e = right.existRecur(l, existMap);
-   if (t == e) {
-      existMap[_node] = t();
-      return t;
-   }
-   if (t.isNegEdge()) {
-      t = ~t; e = ~e; isNegEdge = true;
-   }
-   BddNode res(_BddMgr->uniquify(t(), e(), thisLevel));
-   if (isNegEdge) res = ~res;
-   existMap[_node] = res();
-   return res;
+BddNode
+BddNode::restrict(const BddNode& c) const
+{
+   return _BddMgr->restrict(*this, c);
 }
 
 // Move the BDD nodes in the cone >= fromLevel to toLevel.
@@ -295,12 +361,13 @@ BddNode::nodeMove(unsigned fromLevel, unsigned toLevel, bool& isMoved) const
 {
    assert(fromLevel > 1);
    if (int(getLevel() - fromLevel) >= abs(int(fromLevel - toLevel)) ||
-        containNode(fromLevel - 1, 1)) {
+        containNode(1, fromLevel - 1)) {
       isMoved = false;
       return (*this);
    }
 
    isMoved = true;
+   BddOpGuard guard(_BddMgr);
    map<size_t, size_t> moveMap;
    return nodeMoveRecur(fromLevel, toLevel, moveMap);
 }
@@ -323,9 +390,8 @@ BddNode::nodeMoveRecur
    if (!right.isTerminal())
       right = right.nodeMoveRecur(fromLevel, toLevel, moveMap);
 
-   BddNodeInt *n
+   BddNode ret
    = _BddMgr->uniquify(left(), right(), thisLevel - fromLevel + toLevel);
-   BddNode ret = BddNode(size_t(n));
    if (isNegEdge()) ret = ~ret;
 
    moveMap[_node] = ret();
@@ -338,25 +404,23 @@ BddNode::nodeMoveRecur
 bool
 BddNode::containNode(unsigned bLevel, unsigned eLevel) const
 {
-   bool res = containNodeRecur(bLevel, eLevel);
-   unsetVisitedRecur();
-   return res;
+   BddNodeMarks marks(*this);
+   return containNodeRecur(bLevel, eLevel, marks);
 }
 
 bool
-BddNode::containNodeRecur(unsigned bLevel, unsigned eLevel) const
+BddNode::containNodeRecur(unsigned bLevel, unsigned eLevel,
+                          BddNodeMarks& marks) const
 {
-   BddNodeInt* n = getBddNodeInt();
-   if (n->isVisited())
+   if (!marks.mark(_node))
       return false;
-   n->setVisited();
 
    unsigned thisLevel = getLevel();
    if (thisLevel < bLevel) return false;
    if (thisLevel <= eLevel) return true;
 
-   if (getLeft().containNodeRecur(bLevel, eLevel)) return true;
-   if (getRight().containNodeRecur(bLevel, eLevel)) return true;
+   if (getLeft().containNodeRecur(bLevel, eLevel, marks)) return true;
+   if (getRight().containNodeRecur(bLevel, eLevel, marks)) return true;
 
    return false;
 }     
@@ -364,69 +428,80 @@ BddNode::containNodeRecur(unsigned bLevel, unsigned eLevel) const
 size_t
 BddNode::countCube() const
 {  
-   map<size_t, size_t> numCubeMap;
-   return countCubeRecur(false, numCubeMap);
+   BigNum n = countCubeExact();
+   return (n.numBits() <= 64)? size_t(n.toULL()) : ~size_t(0);
 }  
 
-size_t
-BddNode::countCubeRecur(bool phase, map<size_t, size_t>& numCubeMap) const
+BigNum
+BddNode::countCubeExact() const
+{  
+   BddNodeMemo<BigNum> memo;
+   return countCubeRecur(false, memo);
+}  
+
+BigNum
+BddNode::countCubeRecur(bool phase, BddNodeMemo<BigNum>& memo) const
 {
    if (isTerminal())
       return ((phase ^ isNegEdge())? 0 : 1); 
 
-   map<size_t, size_t>::iterator mi = numCubeMap.find(_node);
-   if (mi != numCubeMap.end()) return (*mi).second;
+   // The count depends on (phase ^ isNegEdge())
+   size_t key = _node ^ size_t(phase);
+   const BigNum* mp = memo.find(key);
+   if (mp) return *mp;
 
-   unsigned numCube = 0;
-   BddNode left = getLeft();
-   numCube += left.countCubeRecur(phase ^ isNegEdge(), numCubeMap);
-   BddNode right = getRight();
-   numCube += right.countCubeRecur(phase ^ isNegEdge(), numCubeMap);
+   BigNum numCube = getLeft().countCubeRecur(phase ^ isNegEdge(), memo);
+   numCube += getRight().countCubeRecur(phase ^ isNegEdge(), memo);
+   return memo.insert(key, numCube);
+}
 
-   numCubeMap[_node] = numCube;
-   return numCube;
+long double
+BddNode::satCount(unsigned nvars) const
+{
+   return _BddMgr->satCount(*this, nvars);
+}
+
+double
+BddNode::probability(const vector<double>& probs) const
+{
+   return _BddMgr->probability(*this, probs);
 }
 
+// Go down by the path counts of countCubeExact(): the ith cube is under the
+// left child iff ith < #paths of the left child
+// ==> O(#levels) steps, instead of going through the first ith paths
 BddNode
 BddNode::getCube(size_t ith) const
 {  
-   ith %= countCube();
+   // No reordering from the counting on
+   // ==> the path counts in memo are of the current levels
+   BddOpGuard guard(_BddMgr);
+   BddNodeMemo<BigNum> memo;
+   BigNum n = countCubeRecur(false, memo);
+   if (n.isZero()) return BddNode::_zero;
+   // ith is always < a count of more than 64 bits
+   if (n.numBits() <= 64) ith %= n.toULL();
    BddNode res = BddNode::_one;
-   size_t idx = 0;
-   getCubeRecur(false, idx, ith, res);
-   return res;
-}
-   
-// return true if the target-th cube is met
-bool
-BddNode::getCubeRecur
-(bool phase, size_t& ith, size_t target, BddNode& res) const
-{
-   if (isTerminal()) {
-      if (!(phase ^ isNegEdge())) {
-         if (ith == target) return true;
-         ++ith;
-      }
-      return false;
+   BigNum target(ith);
+   bool phase = false;
+   for (BddNode f = *this; !f.isTerminal();) {
+      phase ^= f.isNegEdge();
+      const BddNode& x =
+         _BddMgr->getSupport(_BddMgr->getVarOfLevel(f.getLevel()));
+      BddNode left = f.getLeft();
+      BigNum nl = left.countCubeRecur(phase, memo);
+      if (target < nl) { res &= x; f = left; }
+      else { target -= nl; res &= ~x; f = f.getRight(); }
    }
-
-   BddNode old = res;
-   BddNode left = getLeft();
-   res = old & _BddMgr->getSupport(getLevel());
-   if (left.getCubeRecur(phase ^ isNegEdge(), ith, target, res))
-      return true;
-   BddNode right = getRight();
-   res = old & ~(_BddMgr->getSupport(getLevel()));
-   if (right.getCubeRecur(phase ^ isNegEdge(), ith, target, res))
-      return true;
-
-   return false;
+   return res;
 }
 
 vector<BddNode>
 BddNode::getAllCubes() const
 {
    vector<BddNode> allCubes;
+   // No reordering while walking through this BDD
+   BddOpGuard guard(_BddMgr);
    BddNode cube = BddNode::_one;
    getAllCubesRecur(false, cube, allCubes);
    return allCubes;
@@ -444,13 +519,26 @@ BddNode::getAllCubesRecur
 
    BddNode old = cube;
    BddNode left = getLeft();
-   cube = old & _BddMgr->getSupport(getLevel());
+   const BddNode& x = _BddMgr->getSupport(_BddMgr->getVarOfLevel(getLevel()));
+   cube = old & x;
    left.getAllCubesRecur(phase ^ isNegEdge(), cube, allCubes);
    BddNode right = getRight();
-   cube = old & ~(_BddMgr->getSupport(getLevel()));
+   cube = old & ~x;
    right.getAllCubesRecur(phase ^ isNegEdge(), cube, allCubes);
 }
 
+BddCubeIter
+BddNode::cubeBegin() const
+{
+   return BddCubeIter(*this);
+}
+
+BddCubeIter
+BddNode::cubeEnd() const
+{
+   return BddCubeIter();
+}
+
 // Assume this BddNode is a cube
 string
 BddNode::toString() const
@@ -469,12 +557,12 @@ BddNode::toStringRecur(bool phase, string& str) const
 
    stringstream sstr;
    if (getLeft().toStringRecur(phase ^ isNegEdge(), str)) {
-      sstr << "(" << getLevel() << ") ";
+      sstr << "(" << _BddMgr->getVarOfLevel(getLevel()) << ") ";
       str += sstr.str();
       return true;
    }
    else if (getRight().toStringRecur(phase ^ isNegEdge(), str)) {
-      sstr << "!(" << getLevel() << ") ";
+      sstr << "!(" << _BddMgr->getVarOfLevel(getLevel()) << ") ";
       str += sstr.str();
       return true;
    }
@@ -487,14 +575,15 @@ ostream&
 operator << (ostream& os, const BddNode& n)
 {
    size_t nNodes = 0;
-   n.print(os, 0, nNodes);
-   n.unsetVisitedRecur();
+   BddNodeMarks marks(n);
+   n.print(os, 0, nNodes, marks);
    os << endl << endl << "==> Total #BddNodes : " << nNodes << endl;
    return os;
 }
 
 void
-BddNode::print(ostream& os, size_t indent, size_t& nNodes) const
+BddNode::print(ostream& os, size_t indent, size_t& nNodes,
+               BddNodeMarks& marks) const
 {
    for (size_t i = 0; i < indent; ++i)
       os << ' ';
@@ -504,29 +593,16 @@ BddNode::print(ostream& os, size_t indent, size_t& nNodes) const
       os << n << " ";
    if (_debugRefCount)
       os << "(" << n->getRefCount() << ")";
-   if (n->isVisited()) {
+   if (!marks.mark(_node)) {
       os << " (*)";
       return;
    }
    else ++nNodes;
-   n->setVisited();
    if (!isTerminal()) {
       os << endl;
-      n->getLeft().print(os, indent + 2, nNodes);
+      n->getLeft().print(os, indent + 2, nNodes, marks);
       os << endl;
-      n->getRight().print(os, indent + 2, nNodes);
-   }
-}
-
-void
-BddNode::unsetVisitedRecur() const
-{
-   BddNodeInt* n = getBddNodeInt();
-   if (!n->isVisited()) return;
-   n->unsetVisited();
-   if (!isTerminal()) {
-      n->getLeft().unsetVisitedRecur();
-      n->getRight().unsetVisitedRecur();
+      n->getRight().print(os, indent + 2, nNodes, marks);
    }
 }
 
@@ -546,26 +622,23 @@ BddNode::drawBdd(const string& name, ofstream& ofile) const
          << "\" [color = blue]";
    ofile << (isNegEdge()? " [arrowhead = odot]" : ";") << endl;
 
-   drawBddRecur(ofile);
+   BddNodeMarks marks(*this);
+   drawBddRecur(ofile, marks);
 
    ofile << "   { rank = same; 0; \"One\"; }" << endl;
    ofile << "}" << endl;
-
-   unsetVisitedRecur( );
 }
 
 void
-BddNode::drawBddRecur(ofstream& ofile) const
+BddNode::drawBddRecur(ofstream& ofile, BddNodeMarks& marks) const
 {
    // TODO
-   BddNodeInt* n = getBddNodeInt();
-   if (n->isVisited())
+   if (!marks.mark(_node))
       return;
-   n->setVisited();
    if(isTerminal())
       return;
-   BddNode left = getLeft();
-   BddNode right = getRight();
+   BddChild left = getLeft();
+   BddChild right = getRight();
 
    ofile << "   { rank = same; " << getLevel() << "; \"" << getLabel()
          << "\"; }\n";
@@ -577,8 +650,8 @@ BddNode::drawBddRecur(ofstream& ofile) const
          << "\"[style = dotted ] [color=red]";
    ofile << ((right.isNegEdge())? " [arrowhead=odot]" : ";") << endl;
 
-   left.drawBddRecur(ofile);
-   right.drawBddRecur(ofile);
+   left.drawBddRecur(ofile, marks);
+   right.drawBddRecur(ofile, marks);
 }
 
 // Don't put this->isNegEdge() on label
@@ -594,3 +667,61 @@ BddNode::getLabel() const
    return str.str();
 }
 
+//----------------------------------------------------------------------
+//    class BddCubeIter
+//----------------------------------------------------------------------
+BddCubeIter::BddCubeIter(const BddNode& f)
+: _mgr(BddMgr::ownerOf(f)), _root(f),
+  _numReorders(_mgr->getNumReorders()),
+  _isEnd(f() == (_mgr->getSupport(0)() ^ BDD_NEG_EDGE))
+{
+   _path.reserve(f.getLevel());
+   _cube.assign(_mgr->getNumSupports() - 1, '-');
+   if (!_isEnd) descend(f());
+}
+
+// Go along the left-most path from e to 1
+// ==> e must not be const 0; and the child on the path is never const 0,
+//     as a non-constant node has a path to 1
+void
+BddCubeIter::descend(size_t e)
+{
+   size_t one = _mgr->getSupport(0)(), zero = one ^ BDD_NEG_EDGE;
+   BddNodeInt* terminal = _mgr->getNodeInt(one);
+   for (BddNodeInt* p = _mgr->getNodeInt(e); p != terminal;
+        p = _mgr->getNodeInt(e)) {
+      size_t isNeg = e & BDD_NEG_EDGE;
+      size_t t = p->getLeftEdge() ^ isNeg;
+      bool isRight = (t == zero);
+      _path.push_back(make_pair(e, isRight));
+      _cube[_mgr->getVarOfLevel(p->getLevel()) - 1] = isRight? '0' : '1';
+      e = isRight? (p->getRightEdge() ^ isNeg) : t;
+   }
+   assert(e == one);
+}
+
+// Backtrack to the last node whose right child is not taken yet
+// ==> the end if there is no such node
+BddCubeIter&
+BddCubeIter::operator ++ ()
+{
+   assert(!_isEnd && _mgr->getNumReorders() == _numReorders);
+   size_t zero = _mgr->getSupport(0)() ^ BDD_NEG_EDGE;
+   while (!_path.empty()) {
+      size_t e = _path.back().first;
+      BddNodeInt* p = _mgr->getNodeInt(e);
+      unsigned v = _mgr->getVarOfLevel(p->getLevel());
+      size_t r = p->getRightEdge() ^ (e & BDD_NEG_EDGE);
+      if (_path.back().second || r == zero) {
+         _cube[v - 1] = '-';
+         _path.pop_back();
+         continue;
+      }
+      _path.back().second = true;
+      _cube[v - 1] = '0';
+      descend(r);
+      return (*this);
+   }
+   _isEnd = true;
+   return (*this);
+}
@@ -11,16 +11,49 @@
 
 #include <vector>
 #include <map>
+#include <string>
 #include <iostream>
+#include <cassert>
+#include "myPool.h"
+#include "myBigNum.h"
 
 using namespace std;
 
+// An edge (i.e. BddNode::_node) is a BddNodeInt address or, when
+// BDD_COMPACT_NODE is defined, (node index << 1), with the complement
+// flag (BDD_NEG_EDGE) in bit 0.
+// In BDD_COMPACT_NODE mode, the children are stored as 32-bit edges
+// (i.e. BddEdge) in BddNodeInt, and are indices into the node pool of
+// BddMgr. This makes BddNodeInt, and the entries of the unique and
+// computed tables, about half the size. A BddNode also keeps the node
+// pool of its BddMgr in this mode (see BddNode::_pool).
+//
 #define BDD_EDGE_BITS      2
 //#define BDD_NODE_PTR_MASK  ((UINT_MAX >> BDD_EDGE_BITS) << BDD_EDGE_BITS)
 #define BDD_NODE_PTR_MASK  ((~(size_t(0)) >> BDD_EDGE_BITS) << BDD_EDGE_BITS)
+// The node header (_level, _refCount) fits in one 64-bit word
+// BDD_REF_BITS can be narrowed at build time (see test-refsat in Makefile)
+#define BDD_LEVEL_BITS     31
+#ifndef BDD_REF_BITS
+#define BDD_REF_BITS       32
+#endif
+#define BDD_LEVEL_MAX      ((size_t(1) << BDD_LEVEL_BITS) - 1)
+#define BDD_REF_MAX        ((size_t(1) << BDD_REF_BITS) - 1)
 
 class BddMgr;
+class BddNode;
 class BddNodeInt;
+class BddCubeIter;
+class BddNodeMarks;
+template <class T> class BddNodeMemo;
+
+#ifdef BDD_COMPACT_NODE
+typedef unsigned        BddEdge;
+typedef BddNode         BddChild;     // no BddNode stored in BddNodeInt
+#else
+typedef size_t          BddEdge;
+typedef const BddNode&  BddChild;
+#endif
 
 enum BDD_EDGE_FLAG
 {
@@ -30,16 +63,25 @@ enum BDD_EDGE_FLAG
    BDD_EDGE_DUMMY  // dummy end
 };
 
+// The BddMgr of a thread (i.e. BddNode::_BddMgr) and its constants are
+// thread_local, so every thread can run its own BddMgr
+// (see BddMgr::makeCurrent())
+//
 class BddNode
 {
 public:
-   static BddNode          _one;
-   static BddNode          _zero;
+   // of the current BddMgr
+   static thread_local BddNode   _one;
+   static thread_local BddNode   _zero;
    static bool             _debugBddAddr;
    static bool             _debugRefCount;
 
    // no node association yet
+#ifdef BDD_COMPACT_NODE
+   BddNode() : _node(0), _pool(0) {}
+#else
    BddNode() : _node(0) {}
+#endif
    // We check the hash when a new node is possibly being created
    BddNode(size_t l, size_t r, size_t i, BDD_EDGE_FLAG f = BDD_POS_EDGE);
    // Copy constructor also needs to increase the _refCount
@@ -52,8 +94,11 @@ public:
    ~BddNode();
 
    // Basic access functions
-   const BddNode& getLeft() const;
-   const BddNode& getRight() const;
+   BddChild getLeft() const;
+   BddChild getRight() const;
+   // The cofactors by the variable at level i
+   // ==> never trigger garbage collection or reordering, so the levels
+   //     stay as they are across the calls
    BddNode getLeftCofactor(unsigned i) const;
    BddNode getRightCofactor(unsigned i) const;
    unsigned getLevel() const;
@@ -63,7 +108,8 @@ public:
 
    // Operators overloading
    size_t operator () () const { return _node; }
-   BddNode operator ~ () const { return (_node ^ BDD_NEG_EDGE); }
+   BddNode operator ~ () const {
+      BddNode n(*this); n._node ^= BDD_NEG_EDGE; return n; }
    BddNode& operator = (const BddNode& n);
    BddNode operator & (const BddNode& n) const;
    BddNode& operator &= (const BddNode& n);
@@ -80,13 +126,39 @@ public:
 
    // Other BDD operations
    BddNode exist(unsigned l) const;
+   // Quantify the variables in cube (see BddMgr::bddExists())
+   BddNode exists(const BddNode& cube) const;
+   BddNode forall(const BddNode& cube) const;
+   BddNode unique(const BddNode& cube) const;
+   // Substitute g for variable v (see BddMgr::compose())
+   BddNode compose(unsigned v, const BddNode& g) const;
+   // Generalized cofactors w.r.t. care set c (see BddMgr::constrain())
+   BddNode constrain(const BddNode& c) const;
+   BddNode restrict(const BddNode& c) const;
    BddNode nodeMove(unsigned fLevel, unsigned tLevel, bool& isMoved) const;
+   // #paths to 1 (i.e. #disjoint cubes), not #minterms
+   // ==> it can be up to 2^(#levels); countCube() saturates at SIZE_MAX,
+   //     and countCubeExact() is exact
    size_t countCube() const;
+   BigNum countCubeExact() const;
+   // #minterms over the variables at levels 1 ~ nvars
+   // (see BddMgr::satCount())
+   long double satCount(unsigned nvars) const;
+   // P(this = 1) (see BddMgr::probability())
+   double probability(const vector<double>& probs) const;
    BddNode getCube(size_t ith=0) const;
+   // [Note] Every cube is built as a BDD; use cubeBegin() to go through
+   //        the cubes of a large BDD
    vector<BddNode> getAllCubes() const;
+   // The paths to 1 as patterns, without creating any node
+   // (see BddCubeIter)
+   BddCubeIter cubeBegin() const;
+   BddCubeIter cubeEnd() const;
    string toString() const;
 
    friend ostream& operator << (ostream& os, const BddNode& n);
+   friend class BddNodeInt;
+   friend class BddMgr;
 
    // For BDD drawing
    void drawBdd(const string&, ofstream&) const;
@@ -94,62 +166,175 @@ public:
 
    // Static functions
    static void setBddMgr(BddMgr* m) { _BddMgr = m; }
+   static BddMgr* getBddMgr() { return _BddMgr; }
 
 private:
    size_t                  _node;
+#ifdef BDD_COMPACT_NODE
+   // The node pool of the BddMgr of _node (an index of that pool only)
+   // ==> a BddNode of a BddMgr that is not current can still be copied,
+   //     destroyed and read (see BddMgr::makeCurrent())
+   Pool<BddNodeInt>*       _pool;
+#endif
 
    // Static data mebers
-   static BddMgr*          _BddMgr;
+   static thread_local BddMgr*   _BddMgr;
 
    // Private functions
-   BddNodeInt* getBddNodeInt() const {
-      return (BddNodeInt*)(_node & BDD_NODE_PTR_MASK); }
+#ifdef BDD_COMPACT_NODE
+   BddNode(size_t v, Pool<BddNodeInt>* p);
+#endif
+   BddNodeInt* getBddNodeInt() const;
    bool isTerminal() const;
-   void print(ostream&, size_t, size_t&) const;
-   void unsetVisitedRecur() const;
-   void drawBddRecur(ofstream&) const;
+   void print(ostream&, size_t, size_t&, BddNodeMarks&) const;
+   void drawBddRecur(ofstream&, BddNodeMarks&) const;
    // comment out for SoCV BDD
-   BddNode existRecur(unsigned l, map<size_t, size_t>&) const;
    BddNode nodeMoveRecur(unsigned f, unsigned t, map<size_t, size_t>&) const;
    bool containNode(unsigned b, unsigned e) const;
-   bool containNodeRecur(unsigned b, unsigned e) const;
-   size_t countCubeRecur(bool phase, map<size_t, size_t>& numCubeMap) const;
-   bool getCubeRecur(bool p, size_t& ith, size_t target, BddNode& res) const;
+   bool containNodeRecur(unsigned b, unsigned e, BddNodeMarks&) const;
+   BigNum countCubeRecur(bool phase, BddNodeMemo<BigNum>& memo) const;
    void getAllCubesRecur(bool p, BddNode& c, vector<BddNode>& aCubes) const;
    bool toStringRecur(bool p, string& str) const;
 };
 
+// Go through the paths to 1 (i.e. the disjoint cubes) of a BDD, in the
+// same order as getAllCubes(). A cube is a pattern like that of
+// BddMgr::evalCube(), i.e. pattern[v-1] is for variable v, with '-' for
+// the variables not on the path.
+// ==> The state is the current path, i.e. O(#levels), and ++ takes
+//     O(#levels), as every non-constant node leads to 1
+// [Note] The BDD is referenced, so it is safe across garbage collection,
+//        but the iterator cannot be used after the variables are reordered
+// [Note] The nodes are read through the BddMgr of f, which need not be
+//        the current one (see BddMgr::makeCurrent())
+//
+// e.g. for (BddCubeIter ci = f.cubeBegin(); ci != f.cubeEnd(); ++ci)
+//         cout << *ci << endl;
+//
+class BddCubeIter
+{
+public:
+   // the end iterator
+   BddCubeIter() : _mgr(0), _numReorders(0), _isEnd(true) {}
+   BddCubeIter(const BddNode& f);
+
+   const string& operator * () const { return _cube; }
+   const string* operator -> () const { return &_cube; }
+   BddCubeIter& operator ++ ();
+   // [Note] Only the iterators of the same BDD can be compared
+   bool operator == (const BddCubeIter& i) const {
+      return (_isEnd == i._isEnd) && (_isEnd || _path == i._path); }
+   bool operator != (const BddCubeIter& i) const { return !(*this == i); }
+
+private:
+   BddMgr*                 _mgr;
+   BddNode                 _root;
+   size_t                  _numReorders;
+   bool                    _isEnd;
+   // (edge, isRight) of the nodes on the current path, from the root
+   vector<pair<size_t, bool> >  _path;
+   string                  _cube;
+
+   void descend(size_t e);
+};
+
 // Private class
 class BddNodeInt
 {
    friend class BddNode;
    friend class BddMgr;
+   friend class BddCubeIter;
+   friend class BddNodeMarks;
+   friend struct BddNodeHashKeyOf;
 
    // For const 1 and const 0
-   BddNodeInt() : _level(0), _refCount(0), _visited(0) {}
+   BddNodeInt() : _level(0), _refCount(0) {}
 
    // Don't initialize _refCount here...
    // BddNode() will call incRefCount() or decRefCount() instead...
+   // [Note] A new node is dead until it is referenced, and a dead node does
+   //        not hold the references of its children
+   //        ==> _left/_right are assigned without increasing _refCount
+   //        ==> counted in BddMgr::_numDead by BddMgr::newNode()
+#ifdef BDD_COMPACT_NODE
+   BddNodeInt(size_t l, size_t r, unsigned ll)
+   : _left(l), _right(r), _level(ll), _refCount(0)
+   { assert(ll <= BDD_LEVEL_MAX); }
+
+   BddChild getLeft() const { return BddNode(size_t(_left)); }
+   BddChild getRight() const { return BddNode(size_t(_right)); }
+   size_t getLeftEdge() const { return _left; }
+   size_t getRightEdge() const { return _right; }
+#else
    BddNodeInt(size_t l, size_t r, unsigned ll)
-   : _left(l), _right(r), _level(ll), _refCount(0), _visited(0) {}
+   : _level(ll), _refCount(0)
+   { assert(ll <= BDD_LEVEL_MAX); _left._node = l; _right._node = r; }
 
-   const BddNode& getLeft() const { return _left; }
-   const BddNode& getRight() const { return _right; }
+   BddChild getLeft() const { return _left; }
+   BddChild getRight() const { return _right; }
+   size_t getLeftEdge() const { return _left(); }
+   size_t getRightEdge() const { return _right(); }
+#endif
    unsigned getLevel() const { return _level; }
    unsigned getRefCount() const { return _refCount; }
-   void incRefCount() { ++_refCount; }
-   void decRefCount() { --_refCount; }
-   bool isVisited() const { return (_visited == 1); }
-   void setVisited() { _visited = 1; }
-   void unsetVisited() { _visited = 0; }
+   // _refCount saturates, and then sticks, at BDD_REF_MAX instead of
+   // wrapping around
+   // ==> such a node will never be garbage collected
+   void incRefCount() {
+      if (_refCount == BDD_REF_MAX) return;
+      if (_refCount++ == 0) revive(); }
+   void decRefCount() {
+      if (_refCount == BDD_REF_MAX) return;
+      if (--_refCount == 0) kill(); }
+   void revive();
+   void kill();
+   // The BddMgr of this node, current or not (see BddMgr::init())
+   BddMgr* getOwner() const;
+   // For variable reordering only (see bddReorder.cpp)
+   // ==> no _refCount update on the children
+   void setLevel(unsigned l) { assert(l <= BDD_LEVEL_MAX); _level = l; }
+#ifdef BDD_COMPACT_NODE
+   void setChildren(size_t l, size_t r) { _left = l; _right = r; }
+#else
+   void setChildren(size_t l, size_t r) { _left._node = l; _right._node = r; }
+#endif
 
+#ifdef BDD_COMPACT_NODE
+   BddEdge              _left;
+   BddEdge              _right;
+#else
    BddNode              _left;
    BddNode              _right;
-   unsigned             _level    : 16;
-   unsigned             _refCount : 15;
-   unsigned             _visited  : 1;
+#endif
+   unsigned long long   _level    : BDD_LEVEL_BITS;
+   unsigned long long   _refCount : BDD_REF_BITS;
 
-   static BddNodeInt*   _terminal;
+   // of the current BddMgr (see BddNode::_BddMgr)
+   static thread_local BddNodeInt*   _terminal;
+   // The node pool of the BddMgr; to map an index to its BddNodeInt
+   static thread_local Pool<BddNodeInt>*   _nodePool;
+
+   // Get the BddNodeInt of an edge (of the current BddMgr); return 0 if
+   // e = 0
+   static BddNodeInt* getNode(size_t e) {
+#ifdef BDD_COMPACT_NODE
+      assert(!e || (e >> 1) < _nodePool->capacity());
+      return e? _nodePool->at(e >> 1) : 0;
+#else
+      return (BddNodeInt*)(e & BDD_NODE_PTR_MASK);
+#endif
+   }
 };
 
+inline BddNodeInt*
+BddNode::getBddNodeInt() const
+{
+#ifdef BDD_COMPACT_NODE
+   assert(!_node || (_pool && (_node >> 1) < _pool->capacity()));
+   return _node? _pool->at(_node >> 1) : 0;
+#else
+   return BddNodeInt::getNode(_node);
+#endif
+}
+
 #endif // BDD_NODE_H
@@ -0,0 +1,392 @@
+/****************************************************************************
+  FileName     [ bddPar.cpp ]
+  PackageName  [ ]
+  Synopsis     [ Parallel ite of BddMgr ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2005-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <new>
+#include <iostream>
+#include <cassert>
+#include "bddNode.h"
+#include "bddMgr.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    Parallel ite
+//----------------------------------------------------------------------
+// The parallel ite() runs on raw node values (as iteIter()), within the
+// BddOpGuard of ite(); so garbage collection and reordering, and thus
+// all the _refCount updates, are kept out of the threads. What they
+// share is:
+// (1) _uniqueTable: read only (OpenHash::check()), and never changed
+//     until parIte() returns; a new node is inserted to _parHash, a
+//     fixed-size table without any lock (see LockFreeHash) instead, or
+//     to _parOverflow (with _overflowLock) in the rare case that the
+//     probing window of its key is full. parIte() then moves them to
+//     _uniqueTable, and grows _parHash for the next operation if it was
+//     used by more than a quarter
+// (2) _nodePool: every thread allocates from its own batch of
+//     BDD_PAR_ALLOC_BATCH nodes (ParWorker::_spares), and only takes
+//     _poolLock to refill it; the new nodes are added to _numDead, and
+//     the spares returned, by parIte() at the end
+// (3) _parTable, instead of _computedTable: a LossyCache never blocks,
+//     and drops the accesses to a busy entry
+// The nodes are never changed after they are created, so the children
+// and levels can be read without any lock.
+//
+// Forking (work stealing): each thread (0 for the calling one, 1 ~
+// (n - 1) for the workers started by setNumThreads(n)) has its own
+// Chase-Lev deque of forked branches (ParWorker::_tasks). A thread
+// pushes the left branch to the bottom of its deque and does the right
+// branch, down to depth _forkDepth
+// ==> about (2 * #threads) concurrent branches for load balancing
+// Then it joins the left branch: it pops it back and runs it, unless it
+// is stolen; an idle thread steals from the top of another deque (i.e.
+// the largest branch there). A thread waiting for a stolen branch
+// steals the others meanwhile; with nothing to steal, a thread backs off
+// (see backOff()), and then sleeps (_idleCv) until a branch is forked,
+// or the one it waits for is done.
+// No fork below level BDD_PAR_MIN_LEVEL, where a branch is too small to
+// pay for the queueing.
+//
+// [Note] Only measured on one CPU so far (see benchParallel()), where
+//        the threads can only cost time; the scaling over the cores is
+//        yet to be seen
+//
+#define BDD_PAR_MIN_LEVEL       8
+#define BDD_PAR_ALLOC_BATCH     64
+#define BDD_PAR_HASH_SIZE       (1 << 16)
+#define BDD_PAR_OVERFLOW_SIZE   64
+#define BDD_PAR_SPIN_ROUNDS     8
+
+thread_local unsigned BddMgr::_parId = 0;
+
+void
+BddMgr::setNumThreads(unsigned n)
+{
+   assert(_opDepth == 0);
+   stopWorkers();
+#ifdef BDD_COMPACT_NODE
+   if (n > 0)
+      cerr << "Warning: no parallel ite in BDD_COMPACT_NODE mode; "
+           << "setNumThreads(" << n << ") is ignored!!" << endl;
+   n = 0;
+#endif
+   _numThreads = n;
+   for (_forkDepth = 1; (1u << (_forkDepth - 1)) < n; ++_forkDepth);
+   if (n == 1) _forkDepth = 0;
+   if (_parWorkers) { delete [] _parWorkers; _parWorkers = 0; }
+   if (n > 0) {
+      _parWorkers = new ParWorker[n];
+      initParTables();
+   }
+   if (n > 1) startWorkers(n - 1);
+}
+
+// _parHash starts small, and grows with the use (see parIte())
+void
+BddMgr::initParTables()
+{
+   if (_parTable.size() == 0) _parTable.init(_computedTable.size());
+   if (_parHash.size() == 0) _parHash.init(BDD_PAR_HASH_SIZE);
+   if (_parOverflow.numBuckets() == 0)
+      _parOverflow.init(BDD_PAR_OVERFLOW_SIZE);
+}
+
+void
+BddMgr::startWorkers(unsigned n)
+{
+   _stopWorkers = false;
+   for (unsigned i = 1; i <= n; ++i)
+      _workers.push_back(thread(&BddMgr::workerLoop, this, i));
+}
+
+void
+BddMgr::stopWorkers()
+{
+   if (_workers.empty()) return;
+   {
+      lock_guard<mutex> lock(_idleLock);
+      _stopWorkers = true;
+   }
+   _idleCv.notify_all();
+   for (size_t i = 0, n = _workers.size(); i < n; ++i)
+      _workers[i].join();
+   _workers.clear();
+}
+
+// [Note] setCurrent() for every task, as BddNode::_one/_zero change
+//        with restart()
+void
+BddMgr::workerLoop(unsigned id)
+{
+   _parId = id;
+   for (unsigned round = 0; true; ) {
+      ParTask* task = popTask(id);
+      if (!task) task = stealTask(id);
+      if (task) {
+         setCurrent(this);
+         runTask(task);
+         round = 0;
+      }
+      else if (backOff(round, 0)) return;
+   }
+}
+
+// Wait a while for a task to steal (or for task to be done): yield
+// 1, 2, 4, ... times in the first BDD_PAR_SPIN_ROUNDS rounds, and then
+// sleep on _idleCv until woken up by forkTask() (or runTask())
+// Return true if the workers are to stop
+// [Note] _numIdle is raised before _numQueued (task->_isDone) is
+//        checked, and forkTask() (runTask()) does the opposite; so either
+//        the sleeper sees the new task, or it is woken up
+bool
+BddMgr::backOff(unsigned& round, ParTask* task)
+{
+   if (round < BDD_PAR_SPIN_ROUNDS) {
+      for (unsigned i = 0, n = 1u << round++; i < n; ++i)
+         this_thread::yield();
+      return false;
+   }
+   unique_lock<mutex> lock(_idleLock);
+   ++_numIdle;
+   _idleCv.wait(lock, [this, task] {
+      return _stopWorkers || _numQueued > 0 || (task && task->_isDone); });
+   --_numIdle;
+   round = 0;
+   return _stopWorkers;
+}
+
+// Return false if the deque of the thread is full (i.e. not forked)
+bool
+BddMgr::forkTask(ParTask* task)
+{
+   if (!_parWorkers[_parId].push(task)) return false;
+   ++_numQueued;
+   if (_numIdle > 0) {
+      lock_guard<mutex> lock(_idleLock);
+      _idleCv.notify_one();
+   }
+   return true;
+}
+
+// The last one forked by thread id
+BddMgr::ParTask*
+BddMgr::popTask(unsigned id)
+{
+   ParTask* task = _parWorkers[id].pop();
+   if (task) --_numQueued;
+   return task;
+}
+
+// The first one forked by any other thread, from (id + 1) on
+BddMgr::ParTask*
+BddMgr::stealTask(unsigned id)
+{
+   for (unsigned i = 1; i < _numThreads; ++i) {
+      ParTask* task = _parWorkers[(id + i) % _numThreads].steal();
+      if (task) { --_numQueued; return task; }
+   }
+   return 0;
+}
+
+// [Note] task may be gone as soon as _isDone is set
+void
+BddMgr::runTask(ParTask* task)
+{
+   task->_ret = parIteRecur(task->_f, task->_g, task->_h, task->_depth);
+   task->_isDone = true;
+   if (_numIdle > 0) {
+      lock_guard<mutex> lock(_idleLock);
+      _idleCv.notify_all();
+   }
+}
+
+// [Note] The later forks are joined first
+//        ==> task is at the bottom of the deque, unless it is stolen
+//            (and so are all the ones above it)
+size_t
+BddMgr::joinTask(ParTask* task)
+{
+   ParTask* t = popTask(_parId);
+   if (t) {
+      assert(t == task);
+      return parIteRecur(task->_f, task->_g, task->_h, task->_depth);
+   }
+   // Stolen ==> steal the others until it is done
+   for (unsigned round = 0; !task->_isDone; ) {
+      ParTask* other = stealTask(_parId);
+      if (other) { runTask(other); round = 0; }
+      else backOff(round, task);
+   }
+   return task->_ret;
+}
+
+//----------------------------------------------------------------------
+//    class BddMgr::ParWorker
+//----------------------------------------------------------------------
+// The Chase-Lev deque on a fixed ring, with the C11 memory orders of
+// Le et al., "Correct and efficient work-stealing for weak memory
+// models" (PPoPP'13)
+// ==> push() and pop() by the owner thread only; steal() by any thread
+//
+bool
+BddMgr::ParWorker::push(ParTask* task)
+{
+   long long b = _bottom.load(memory_order_relaxed);
+   long long t = _top.load(memory_order_acquire);
+   if (b - t >= BDD_PAR_DEQUE_SIZE) return false;
+   _tasks[b & (BDD_PAR_DEQUE_SIZE - 1)].store(task, memory_order_relaxed);
+   atomic_thread_fence(memory_order_release);
+   _bottom.store(b + 1, memory_order_relaxed);
+   return true;
+}
+
+// Return 0 if empty, or the last one is stolen meanwhile
+BddMgr::ParTask*
+BddMgr::ParWorker::pop()
+{
+   long long b = _bottom.load(memory_order_relaxed) - 1;
+   _bottom.store(b, memory_order_relaxed);
+   atomic_thread_fence(memory_order_seq_cst);
+   long long t = _top.load(memory_order_relaxed);
+   ParTask* task = 0;
+   if (t <= b) {
+      task = _tasks[b & (BDD_PAR_DEQUE_SIZE - 1)].load(memory_order_relaxed);
+      if (t == b) {
+         // The last one ==> race with the thieves for it
+         if (!_top.compare_exchange_strong(t, t + 1, memory_order_seq_cst,
+                                           memory_order_relaxed))
+            task = 0;
+         _bottom.store(b + 1, memory_order_relaxed);
+      }
+   }
+   else _bottom.store(b + 1, memory_order_relaxed);
+   return task;
+}
+
+// Return 0 if empty, or the top one is taken by another thread meanwhile
+BddMgr::ParTask*
+BddMgr::ParWorker::steal()
+{
+   long long t = _top.load(memory_order_acquire);
+   atomic_thread_fence(memory_order_seq_cst);
+   long long b = _bottom.load(memory_order_acquire);
+   if (t >= b) return 0;
+   ParTask* task =
+      _tasks[t & (BDD_PAR_DEQUE_SIZE - 1)].load(memory_order_relaxed);
+   if (!_top.compare_exchange_strong(t, t + 1, memory_order_seq_cst,
+                                     memory_order_relaxed))
+      return 0;
+   return task;
+}
+
+//----------------------------------------------------------------------
+//    Parallel ite (cont.)
+//----------------------------------------------------------------------
+// Called by ite(), bddAnd() and bddXor() with _numThreads > 0
+// ==> All the forked tasks are joined when parIteRecur() returns, so
+//     the workers no longer touch _parHash, _parOverflow or their
+//     ParWorkers
+size_t
+BddMgr::parIte(size_t f, size_t g, size_t h)
+{
+   size_t ret = parIteRecur(f, g, h, 0);
+   size_t numNew = 0;
+   for (unsigned i = 0; i < _numThreads; ++i) {
+      ParWorker& w = _parWorkers[i];
+      for (size_t j = 0, n = w._newNodes.size(); j < n; ++j) {
+         size_t e = w._newNodes[j];
+         BddNodeInt* p = getNodeInt(e);
+         _uniqueTable[p->getLevel()].forceInsert(BddNodeHashKeyOf()(e), e);
+      }
+      numNew += w._newNodes.size();
+      w._newNodes.clear();
+      for (size_t j = 0, n = w._newSlots.size(); j < n; ++j)
+         _parHash.clear(w._newSlots[j]);
+      w._newSlots.clear();
+      for (size_t j = 0, n = w._spares.size(); j < n; ++j)
+         _nodePool.free(w._spares[j]);
+      w._spares.clear();
+   }
+   _numDead += numNew;
+   if (!_parOverflow.empty()) _parOverflow.init(BDD_PAR_OVERFLOW_SIZE);
+   if (numNew > _parHash.size() / 4) _parHash.init(numNew * 4);
+   return ret;
+}
+
+size_t
+BddMgr::parIteRecur(size_t f, size_t g, size_t h, unsigned depth)
+{
+   bool isNegEdge = false;
+   standardize(f, g, h, isNegEdge);
+
+   size_t ret;
+   BddEdge ret_t;
+   BddCacheKey k(BDD_OP_ITE, f, g, h);
+   if (checkIteTerminal(f, g, h, ret))
+      ;
+   else if (_parTable.read(k, ret_t))
+      ret = ret_t;
+   else {
+      unsigned v = edgeLevel(f);
+      if (edgeLevel(g) > v) v = edgeLevel(g);
+      if (edgeLevel(h) > v) v = edgeLevel(h);
+      size_t fl = edgeCofactor(f, v, true), fr = edgeCofactor(f, v, false);
+      size_t gl = edgeCofactor(g, v, true), gr = edgeCofactor(g, v, false);
+      size_t hl = edgeCofactor(h, v, true), hr = edgeCofactor(h, v, false);
+      size_t t, e;
+      ParTask task(fl, gl, hl, depth + 1);
+      if (depth < _forkDepth && v >= BDD_PAR_MIN_LEVEL && forkTask(&task)) {
+         e = parIteRecur(fr, gr, hr, depth + 1);
+         t = joinTask(&task);
+      }
+      else {
+         t = parIteRecur(fl, gl, hl, depth + 1);
+         e = parIteRecur(fr, gr, hr, depth + 1);
+      }
+      // g is a posEdge ==> so is t
+      assert(!(t & BDD_NEG_EDGE));
+      ret = (t == e)? t : parUniquify(t, e, v);
+      _parTable.write(k, ret);
+   }
+   return isNegEdge? (ret ^ BDD_NEG_EDGE) : ret;
+}
+
+// Same as uniquify(), but thread-safe
+// ==> newNode() from the spares of the thread, without _poolLock
+// [Note] A new node is built before it is inserted; if another thread
+//        inserts the same one first, it goes back to the spares
+// [Note] Never in BDD_COMPACT_NODE mode (see setNumThreads())
+size_t
+BddMgr::parUniquify(size_t l, size_t r, unsigned i)
+{
+   BddEdge n = 0;
+   BddHashKey k(l, r, i);
+   if (_uniqueTable[i].check(k, n)) return n;
+   size_t d = _parHash.find(k);
+   if (d) return d;
+
+   ParWorker& w = _parWorkers[_parId];
+   if (w._spares.empty()) {
+      lock_guard<mutex> poolLock(_poolLock);
+      for (size_t j = 0; j < BDD_PAR_ALLOC_BATCH; ++j)
+         w._spares.push_back(_nodePool.alloc());
+   }
+   d = size_t(new (w._spares.back()) BddNodeInt(l, r, i));
+   size_t s;
+   n = _parHash.insert(k, d, s);
+   if (n == d) w._newSlots.push_back(s);
+   else if (n == 0) {
+      lock_guard<mutex> overflowLock(_overflowLock);
+      if (!_parOverflow.check(k, n)) _parOverflow.forceInsert(k, n = d);
+   }
+   if (n == d) {
+      w._spares.pop_back();
+      w._newNodes.push_back(d);
+   }
+   return n;
+}
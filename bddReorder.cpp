@@ -0,0 +1,227 @@
+/****************************************************************************
+  FileName     [ bddReorder.cpp ]
+  PackageName  [ ]
+  Synopsis     [ Dynamic variable reordering of BddMgr ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2005-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <ctime>
+#include "bddNode.h"
+#include "bddMgr.h"
+
+using namespace std;
+
+//----------------------------------------------------------------------
+//    Variable reordering
+//----------------------------------------------------------------------
+// The variables at two adjacent levels are swapped in place: a node
+// keeps its address (or index) and its function, and only its level
+// and children may change. Therefore, all the BddNode handles (e.g.
+// _supports, _bddArr, _bddMap) remain valid.
+//
+// During reordering (i.e. between beginReorder() and endReorder()),
+// a node whose _refCount drops to 0 is removed from _uniqueTable right
+// away, and becomes a "zombie" (_level = BDD_LEVEL_MAX). Zombies are
+// freed in endReorder().
+// [Note] There is no dead node during reordering (see beginReorder())
+//        ==> getLevelSize(l) is the exact #nodes at level l
+//
+void
+BddMgr::swapLevels(unsigned l)
+{
+   assert(_opDepth == 0);
+   beginReorder();
+   swapInPlace(l);
+   endReorder();
+}
+
+size_t
+BddMgr::reorder()
+{
+   assert(_opDepth == 0);
+   size_t nin = _supports.size() - 1;
+   if (nin < 2) return getNumLiveNodes();
+
+   clock_t start = clock();
+   beginReorder();
+   // Sift the variables in the decreasing order of their level sizes
+   vector<pair<size_t, unsigned> > order;
+   for (unsigned l = 1; l <= nin; ++l)
+      order.push_back(make_pair(getLevelSize(l), _level2Var[l]));
+   sort(order.rbegin(), order.rend());
+   for (size_t i = 0; i < nin && !isReorderTimeout(start); ++i)
+      siftVar(order[i].second, start);
+   endReorder();
+   return getNumLiveNodes();
+}
+
+void
+BddMgr::beginReorder()
+{
+   // The nodes are rebuilt by the BddNode functions
+   assert(isCurrent());
+   // ==> Every node in _uniqueTable holds the references of its children
+   garbageCollect();
+   assert(_numDead == 0);
+}
+
+void
+BddMgr::endReorder()
+{
+   // The other _computedTable entries are still correct, as every node
+   // keeps its function
+   purgeComputedTable(&BddMgr::isZombieEdge);
+   for (size_t i = 0, n = _zombies.size(); i < n; ++i)
+      recycleNode(_zombies[i]);
+   _zombies.clear();
+   ++_numReorders;
+
+   _reorderTrigger = 2 * getNumLiveNodes();
+   if (_reorderTrigger < BDD_REORDER_MIN_NODES)
+      _reorderTrigger = BDD_REORDER_MIN_NODES;
+}
+
+// Move variable v all the way to the nearer end (level 1 or nin), then
+// to the other end, and finally back to the level with the fewest nodes.
+// A direction is aborted if the BDDs grow by more than _reorderMaxGrowth.
+void
+BddMgr::siftVar(unsigned v, clock_t start)
+{
+   unsigned nin = _supports.size() - 1;
+   unsigned l = _var2Level[v], bestLevel = l;
+   size_t best = getNumLiveNodes();
+   bool down = (l - 1 <= nin - l);
+   for (unsigned pass = 0; pass < 2; ++pass, down = !down) {
+      while (down? (l > 1) : (l < nin)) {
+         if (down) swapInPlace(--l);
+         else swapInPlace(l++);
+         size_t s = getNumLiveNodes();
+         if (s < best) { best = s; bestLevel = l; }
+         if (s > _reorderMaxGrowth * best || isReorderTimeout(start))
+            break;
+      }
+   }
+   while (l > bestLevel) swapInPlace(--l);
+   while (l < bestLevel) swapInPlace(l++);
+}
+
+// Swap the variables x (at level u = l+1) and y (at level l).
+// For a node F at level u,
+//    F = x ? (y ? f11 : f10) : (y ? f01 : f00)
+//      = y ? (x ? f11 : f01) : (x ? f10 : f00)
+// ==> F stays at level u with the new children at level l
+//     (unless F does not depend on y; then F just moves to level l)
+// ==> the nodes at level l move up to level u
+//
+void
+BddMgr::swapInPlace(unsigned l)
+{
+   unsigned u = l + 1;
+   assert(l > 0 && u < getNumLevels());
+   BddHash &ut = _uniqueTable[u], &lt = _uniqueTable[l];
+
+   // Take the nodes at both levels out of _uniqueTable; otherwise a new
+   // node of x at level l may hit an old node of y with the same children
+   vector<size_t> xNodes, yNodes;
+   takeLevel(u, xNodes);
+   takeLevel(l, yNodes);
+
+   // The nodes of x that do not depend on y must be reinserted first, as
+   // they may be shared by the new nodes of x
+   size_t nx = 0;
+   for (size_t i = 0, n = xNodes.size(); i < n; ++i) {
+      BddNodeInt* f = BddNodeInt::getNode(xNodes[i]);
+      size_t f1 = f->getLeftEdge(), f0 = f->getRightEdge();
+      if (edgeLevel(f1) == l || edgeLevel(f0) == l)
+         xNodes[nx++] = xNodes[i];
+      else {
+         f->setLevel(l);
+         lt.forceInsert(BddHashKey(f1, f0, l), xNodes[i]);
+      }
+   }
+   xNodes.resize(nx);
+
+   for (size_t i = 0; i < nx; ++i) {
+      BddNodeInt* f = BddNodeInt::getNode(xNodes[i]);
+      size_t f1 = f->getLeftEdge(), f0 = f->getRightEdge();
+      size_t t = refNode(edgeCofactor(f1, l, true),
+                         edgeCofactor(f0, l, true), l);
+      size_t e = refNode(edgeCofactor(f1, l, false),
+                         edgeCofactor(f0, l, false), l);
+      // f1 is a posEdge ==> so is t
+      assert(!(t & BDD_NEG_EDGE) && t != e);
+      f->setChildren(t, e);
+      ut.forceInsert(BddHashKey(t, e, u), xNodes[i]);
+      derefNode(f1);
+      derefNode(f0);
+   }
+
+   // The nodes of y that are still alive
+   for (size_t i = 0, n = yNodes.size(); i < n; ++i) {
+      BddNodeInt* g = BddNodeInt::getNode(yNodes[i]);
+      if (g->getLevel() != l) continue;  // zombie
+      g->setLevel(u);
+      ut.forceInsert(
+         BddHashKey(g->getLeftEdge(), g->getRightEdge(), u), yNodes[i]);
+   }
+
+   unsigned x = _level2Var[u], y = _level2Var[l];
+   _level2Var[u] = y; _var2Level[y] = u;
+   _level2Var[l] = x; _var2Level[x] = l;
+}
+
+// Move all the nodes at level l from _uniqueTable to nodes
+// ==> The subtable is also resized, as the #nodes at a level may change
+//     a lot during sifting
+void
+BddMgr::takeLevel(unsigned l, vector<size_t>& nodes)
+{
+   BddHash& ht = _uniqueTable[l];
+   nodes.reserve(ht.size());
+   for (BddHash::iterator bi = ht.begin(); bi != ht.end(); ++bi)
+      nodes.push_back((*bi).second);
+   ht.init(2 * nodes.size());
+}
+
+// Return the node (x ? t : e) at level l, with its _refCount increased
+// ==> same as getNode(), but on raw node values
+size_t
+BddMgr::refNode(size_t t, size_t e, unsigned l)
+{
+   size_t n = t;
+   if (t != e) {
+      if (t & BDD_NEG_EDGE)
+         n = uniquify(t ^ BDD_NEG_EDGE, e ^ BDD_NEG_EDGE, l) ^ BDD_NEG_EDGE;
+      else
+         n = uniquify(t, e, l);
+   }
+   BddNodeInt::getNode(n)->incRefCount();
+   return n;
+}
+
+// Decrease the _refCount of e; turn it into a zombie when it reaches 0
+void
+BddMgr::derefNode(size_t e)
+{
+   BddNodeInt* p = BddNodeInt::getNode(e);
+   if (p->_refCount == BDD_REF_MAX) return;
+   assert(p->_refCount > 0);
+   if (--p->_refCount != 0) return;
+
+   // p may have been taken out of _uniqueTable by swapInPlace(), and
+   // another node may have the same key by now
+   size_t l = p->getLeftEdge(), r = p->getRightEdge();
+   BddHash& ht = _uniqueTable[p->getLevel()];
+   BddHashKey k(l, r, p->getLevel());
+   BddEdge n;
+   e &= ~size_t(BDD_NEG_EDGE);
+   if (ht.check(k, n) && n == e)
+      ht.remove(k);
+   p->setLevel(BDD_LEVEL_MAX);
+   _zombies.push_back(e);
+   derefNode(l);
+   derefNode(r);
+}
@@ -0,0 +1,587 @@
+/****************************************************************************
+  FileName     [ benchBdd.cpp ]
+  PackageName  [ ]
+  Synopsis     [ Benchmarks of the BDD package ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2005-present DVLab, GIEE, NTU, Taiwan ]
+****************************************************************************/
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <sstream>
+#include <ctime>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+#include <cassert>
+#include <map>
+#include "bddNode.h"
+#include "bddMgr.h"
+#include "bddCompiled.h"
+
+using namespace std;
+
+// Usage: benchBdd [benchmark [size]]
+//        ==> run all the benchmarks if no benchmark is given
+
+/**************************************************************************/
+/*                    Define Static Function Prototypes                   */
+/**************************************************************************/
+static double cpuTime(clock_t start);
+static void report(const string& name, double base, double t, size_t n);
+static BddNode queens(BddMgr& bm, int n, bool useIte);
+static void benchApply(int n);
+static void benchIte(int n);
+static void benchReorder(int n);
+static void benchExists(int n);
+static void benchImage(int n);
+static BddNode naiveCofactor(const BddNode& f, unsigned i);
+static void benchCofactor(int n);
+static void benchCount(int n);
+static void benchSample(int n);
+static void benchCubes(int n);
+static void benchIsop(int n);
+static void benchEval(int n);
+static void benchParallel(int n);
+static void benchManagers(int n);
+static void benchTraverse(int n);
+
+
+/**************************************************************************/
+/*                             Define main()                              */
+/**************************************************************************/
+int
+main(int argc, char** argv)
+{
+   string bench = (argc > 1)? argv[1] : "all";
+   int size = (argc > 2)? atoi(argv[2]) : 0;
+
+   if (bench == "all" || bench == "apply")
+      benchApply(size? size : 8);
+   if (bench == "all" || bench == "ite")
+      benchIte(size? size : 2000);
+   if (bench == "all" || bench == "reorder")
+      benchReorder(size? size : 14);
+   if (bench == "all" || bench == "exists")
+      benchExists(size? size : 7);
+   if (bench == "all" || bench == "image")
+      benchImage(size? size : 20);
+   if (bench == "all" || bench == "cofactor")
+      benchCofactor(size? size : 22);
+   if (bench == "all" || bench == "count")
+      benchCount(size? size : 1000);
+   if (bench == "all" || bench == "sample")
+      benchSample(size? size : 8);
+   if (bench == "all" || bench == "cubes")
+      benchCubes(size? size : 14);
+   if (bench == "all" || bench == "isop")
+      benchIsop(size? size : 40);
+   if (bench == "all" || bench == "eval")
+      benchEval(size? size : 16);
+   if (bench == "all" || bench == "parallel")
+      benchParallel(size? size : 64);
+   if (bench == "all" || bench == "managers")
+      benchManagers(size? size : 8);
+   if (bench == "all" || bench == "traverse")
+      benchTraverse(size? size : 20);
+}
+
+
+/**************************************************************************/
+/*                          Define Static Functions                       */
+/**************************************************************************/
+static double
+cpuTime(clock_t start)
+{
+   return double(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void
+report(const string& name, double base, double t, size_t n)
+{
+   cout << "  " << left << setw(24) << name << right << fixed
+        << setprecision(3) << setw(8) << t << " sec";
+   if (base > 0) cout << "  (x" << setprecision(2) << base / t << ")";
+   cout << "  #nodes = " << n << endl;
+}
+
+// Build the n-queens constraint with AND/OR, either by ite() or by the
+// binary apply kernels
+static BddNode
+queens(BddMgr& bm, int n, bool useIte)
+{
+   const BddNode& one = BddNode::_one;
+   const BddNode& zero = BddNode::_zero;
+   BddNode res = one;
+   for (int i = 0; i < n; ++i) {
+      BddNode row = zero;
+      for (int j = 0; j < n; ++j) {
+         const BddNode& x = bm.getSupport(i * n + j + 1);
+         row = useIte? bm.ite(row, one, x) : bm.bddOr(row, x);
+      }
+      res = useIte? bm.ite(res, row, zero) : bm.bddAnd(res, row);
+   }
+   for (int i = 0; i < n; ++i)
+      for (int j = 0; j < n; ++j) {
+         BddNode c = one;
+         for (int a = 0; a < n; ++a)
+            for (int b = 0; b < n; ++b) {
+               if (a == i && b == j) continue;
+               if (a != i && b != j && a - b != i - j && a + b != i + j)
+                  continue;
+               BddNode x = ~bm.getSupport(a * n + b + 1);
+               c = useIte? bm.ite(c, x, zero) : bm.bddAnd(c, x);
+            }
+         BddNode nx = ~bm.getSupport(i * n + j + 1);
+         c = useIte? bm.ite(nx, one, c) : bm.bddOr(nx, c);
+         res = useIte? bm.ite(res, c, zero) : bm.bddAnd(res, c);
+      }
+   return res;
+}
+
+static void
+benchApply(int n)
+{
+   cout << "[apply] " << n << "-queens by AND/OR" << endl;
+   double base = 0;
+   for (int useIte = 1; useIte >= 0; --useIte) {
+      BddMgr bm(n * n, 1 << 16, 1 << 18);
+      clock_t start = clock();
+      BddNode res = queens(bm, n, useIte);
+      double t = cpuTime(start);
+      report(useIte? "ite" : "bddAnd/bddOr", base, t, bm.getNumNodes());
+      if (useIte) base = t;
+   }
+}
+
+// Build (x == y) for two n-bit words, from the MSB down to the LSB, so that
+// every ite() call goes through the whole (deep) BDD built so far
+static void
+benchIte(int n)
+{
+   cout << "[ite] " << n << "-bit equality, " << 2 * n << " levels" << endl;
+   double base = 0;
+   for (int iter = 0; iter <= 1; ++iter) {
+      BddMgr bm(2 * n, 1 << 16, 1 << 18);
+      bm.setIterativeIte(iter);
+      clock_t start = clock();
+      BddNode eq = BddNode::_one;
+      for (int i = n; i > 0; --i) {
+         const BddNode& x = bm.getSupport(2 * i - 1);
+         const BddNode& y = bm.getSupport(2 * i);
+         eq = bm.ite(bm.ite(x, y, ~y), eq, BddNode::_zero);
+      }
+      double t = cpuTime(start);
+      report(iter? "iterative" : "recursive", base, t, bm.getNumNodes());
+      if (!iter) base = t;
+   }
+}
+
+// x1 & x(n+1) | x2 & x(n+2) | ... | xn & x(2n) is exponential in the
+// initial order, and linear if every pair of variables is adjacent
+static void
+benchReorder(int n)
+{
+   cout << "[reorder] sum of " << n << " products by sifting" << endl;
+   BddMgr bm(2 * n, 1 << 16, 1 << 18);
+   clock_t start = clock();
+   BddNode f = BddNode::_zero;
+   for (int i = 1; i <= n; ++i)
+      f |= bm.getSupport(i) & bm.getSupport(i + n);
+   bm.garbageCollect();
+   report("build", 0, cpuTime(start), bm.getNumLiveNodes());
+   start = clock();
+   size_t s = bm.reorder();
+   report("sifting", 0, cpuTime(start), s);
+}
+
+// Quantify the first half of the rows out of the n-queens constraint,
+// one variable at a time or by one cube
+static void
+benchExists(int n)
+{
+   cout << "[exists] " << n << "-queens, " << n / 2 * n << " variables"
+        << endl;
+   double base = 0;
+   for (int useCube = 0; useCube <= 1; ++useCube) {
+      BddMgr bm(n * n, 1 << 16, 1 << 18);
+      BddNode f = queens(bm, n, false);
+      clock_t start = clock();
+      BddNode cube = BddNode::_one;
+      for (int i = 1; i <= n / 2 * n; ++i) {
+         if (useCube) cube &= bm.getSupport(i);
+         else f = f.exist(bm.getLevelOfVar(i));
+      }
+      if (useCube) f = f.exists(cube);
+      double t = cpuTime(start);
+      report(useCube? "exists(cube)" : "exist(level) chain", base, t,
+             bm.getNumNodes());
+      if (!useCube) base = t;
+   }
+}
+
+// The image of an n-bit counter, with x[i] (current state) at variable
+// 2i-1 and y[i] (next state) at 2i
+// ==> exists x. S(x) & T(x, y), where T: y = x + 1, and
+//     S: x[1..n/2] & x[n/2+1..n] (as two numbers) are equal
+static void
+benchImage(int n)
+{
+   cout << "[image] " << n << "-bit counter" << endl;
+   double base = 0;
+   for (int fused = 0; fused <= 1; ++fused) {
+      BddMgr bm(2 * n, 1 << 16, 1 << 18);
+      BddNode t = BddNode::_one, s = BddNode::_one, carry = BddNode::_one;
+      BddNode cube = BddNode::_one;
+      for (int i = 1; i <= n; ++i) {
+         const BddNode& x = bm.getSupport(2 * i - 1);
+         const BddNode& y = bm.getSupport(2 * i);
+         t &= bm.bddXnor(y, x ^ carry);
+         carry &= x;
+         cube &= x;
+         if (i <= n / 2)
+            s &= bm.bddXnor(x, bm.getSupport(2 * (i + n / 2) - 1));
+      }
+      size_t n0 = bm.getNumNodes();
+      clock_t start = clock();
+      BddNode img = fused? bm.bddAndExists(s, t, cube) :
+                           bm.bddExists(s & t, cube);
+      double tm = cpuTime(start);
+      report(fused? "bddAndExists" : "bddAnd + bddExists", base, tm,
+             bm.getNumNodes() - n0);
+      if (!fused) base = tm;
+   }
+}
+
+// The left cofactor w.r.t. level i by plain recursion, without any memo
+// (i.e. the original BddNode::getLeftCofactor())
+static BddNode
+naiveCofactor(const BddNode& f, unsigned i)
+{
+   if (i > f.getLevel()) return f;
+   if (i == f.getLevel())
+      return f.isNegEdge()? ~f.getLeft() : f.getLeft();
+   BddNode t = naiveCofactor(f.getLeft(), i);
+   BddNode e = naiveCofactor(f.getRight(), i);
+   if (t == e) return f.isNegEdge()? ~t : t;
+   BDD_EDGE_FLAG fl = (f.isNegEdge() ^ t.isNegEdge())?
+                       BDD_NEG_EDGE: BDD_POS_EDGE;
+   if (t.isNegEdge()) { t = ~t; e = ~e; }
+   return BddNode(t(), e(), f.getLevel(), fl);
+}
+
+// Parity of n variables: 2 nodes per level, but 2^n paths
+// ==> cofactor w.r.t. the lowest variable
+static void
+benchCofactor(int n)
+{
+   cout << "[cofactor] " << n << "-input parity, by the lowest variable"
+        << endl;
+   BddMgr bm(n, 1 << 16, 1 << 18);
+   BddNode f = BddNode::_zero;
+   for (int i = 1; i <= n; ++i)
+      f ^= bm.getSupport(i);
+   clock_t start = clock();
+   BddNode r0 = naiveCofactor(f, 1);
+   double base = cpuTime(start);
+   report("no memo", 0, base, bm.getNumNodes());
+   start = clock();
+   BddNode r1 = f.getLeftCofactor(1);
+   report("memoized", base, cpuTime(start), bm.getNumNodes());
+   assert(r0 == r1);
+}
+
+// Count the minterms of (x == y) for two n-bit words; the result is 2^n
+static void
+benchCount(int n)
+{
+   cout << "[count] " << n << "-bit equality, " << 2 * n << " variables"
+        << endl;
+   BddMgr bm(2 * n, 1 << 16, 1 << 18);
+   BddNode eq = BddNode::_one;
+   for (int i = 1; i <= n; ++i)
+      eq &= bm.bddXnor(bm.getSupport(2 * i - 1), bm.getSupport(2 * i));
+   const int rounds = 20;
+   clock_t start = clock();
+   BigNum paths;
+   for (int r = 0; r < rounds; ++r) paths = eq.countCubeExact();
+   double base = cpuTime(start);
+   report("countCubeExact", 0, base, bm.getNumNodes());
+   start = clock();
+   long double d = 0;
+   for (int r = 0; r < rounds; ++r) d = bm.satCountLog2(eq, 2 * n);
+   report("satCountLog2", base, cpuTime(start), bm.getNumNodes());
+   start = clock();
+   BigNum b;
+   for (int r = 0; r < rounds; ++r) b = bm.satCountExact(eq, 2 * n);
+   report("satCountExact", base, cpuTime(start), bm.getNumNodes());
+   cout << "  #bits of #paths = " << paths.numBits()
+        << ", log2(#minterms) = " << double(d)
+        << ", #bits of the exact count = " << b.numBits() << endl;
+}
+
+// Draw uniform solutions of the n-queens; the first draw pays for the
+// minterm counts, and each of the others is one path of O(n^2) levels
+static void
+benchSample(int n)
+{
+   cout << "[sample] " << n << "-queens" << endl;
+   BddMgr bm(n * n, 1 << 16, 1 << 18);
+   BddNode q = queens(bm, n, false);
+   const size_t rounds = 100000;
+   clock_t start = clock();
+   BddSampler sampler(q, 1);
+   vector<vector<bool> > samples;
+   sampler.sample(rounds, samples);
+   report("BddSampler", 0, cpuTime(start), bm.getNumNodes());
+
+   // Check the samples and the frequency of each solution
+   map<vector<bool>, size_t> freq;
+   for (size_t i = 0; i < rounds; ++i) {
+      string p(n * n, '0');
+      for (int v = 1; v <= n * n; ++v) if (samples[i][v]) p[v - 1] = '1';
+      assert(bm.evalCube(q, p) == 1);
+      ++freq[samples[i]];
+   }
+   size_t lo = rounds, hi = 0;
+   for (map<vector<bool>, size_t>::iterator mi = freq.begin();
+        mi != freq.end(); ++mi) {
+      lo = min(lo, mi->second); hi = max(hi, mi->second);
+   }
+   cout << "  #solutions = " << bm.satCountExact(q, n * n)
+        << ", #distinct samples = " << freq.size()
+        << ", frequency = " << lo << " ~ " << hi << endl;
+}
+
+// Go through the 2^n cubes of (x == y) for two n-bit words
+static void
+benchCubes(int n)
+{
+   cout << "[cubes] " << n << "-bit equality, " << 2 * n << " variables"
+        << endl;
+   size_t nc = 0;
+   double base = 0;
+   for (int useIter = 0; useIter < 2; ++useIter) {
+      BddMgr bm(2 * n, 1 << 16, 1 << 18);
+      BddNode eq = BddNode::_one;
+      for (int i = 1; i <= n; ++i)
+         eq &= bm.bddXnor(bm.getSupport(2 * i - 1), bm.getSupport(2 * i));
+      clock_t start = clock();
+      if (useIter) {
+         for (BddCubeIter ci = eq.cubeBegin(); ci != eq.cubeEnd(); ++ci)
+            ++nc;
+         report("BddCubeIter", base, cpuTime(start), bm.getNumNodes());
+      }
+      else {
+         vector<BddNode> cubes = eq.getAllCubes();
+         nc = cubes.size();
+         base = cpuTime(start);
+         report("getAllCubes", 0, base, bm.getNumNodes());
+      }
+   }
+   cout << "  #cubes = " << nc << endl;
+}
+
+// The sum of (x[i] & x[i+1]) for i = 1 ~ n-1, which has n-1 prime cubes
+// but a Fibonacci number of disjoint paths
+static void
+benchIsop(int n)
+{
+   cout << "[isop] chain of " << n - 1 << " pairs" << endl;
+   BddMgr bm(n, 1 << 16, 1 << 18);
+   BddNode f = BddNode::_zero;
+   for (int i = 1; i < n; ++i)
+      f |= bm.getSupport(i) & bm.getSupport(i + 1);
+   clock_t start = clock();
+   vector<string> cubes;
+   BddNode c = bm.isop(f, f, &cubes);
+   double base = cpuTime(start);
+   report("isop (first)", 0, base, bm.getNumNodes());
+   // The cover functions of all the sub-intervals are in the cache now
+   const int rounds = 1000;
+   start = clock();
+   for (int r = 0; r < rounds; ++r) c = bm.isop(f, f);
+   report("isop (cached) x1000", 0, cpuTime(start), bm.getNumNodes());
+   assert(c == f);
+   cout << "  #paths = " << f.countCube() << ", #cubes of isop = "
+        << cubes.size() << endl;
+}
+
+// Evaluate 2^n random patterns on the (x + y == z) relation of 8-bit
+// words, whose BDD has all the 24 levels
+static void
+benchEval(int n)
+{
+   const int b = 8, nin = 3 * b;
+   const size_t np = size_t(1) << n;
+   cout << "[eval] " << np << " patterns, " << b << "-bit adder relation"
+        << endl;
+   BddMgr bm(nin, 1 << 16, 1 << 18);
+   // x[i], y[i], z[i] are variables 3i+1, 3i+2, 3i+3 (LSB first)
+   BddNode f = BddNode::_one, c = BddNode::_zero;
+   for (int i = 0; i < b; ++i) {
+      const BddNode& x = bm.getSupport(3 * i + 1);
+      const BddNode& y = bm.getSupport(3 * i + 2);
+      const BddNode& z = bm.getSupport(3 * i + 3);
+      f &= bm.bddXnor(z, x ^ y ^ c);
+      c = (x & y) | (c & (x ^ y));
+   }
+   srand(1);
+   vector<string> pats(np, string(nin, '0'));
+   for (size_t j = 0; j < np; ++j) {
+      // half of the patterns satisfy f
+      unsigned x = rand() & 0xff, y = rand() & 0xff;
+      unsigned z = (rand() & 1)? (x + y) & 0xff : rand() & 0xff;
+      for (int i = 0; i < b; ++i) {
+         if ((x >> i) & 1) pats[j][3 * i] = '1';
+         if ((y >> i) & 1) pats[j][3 * i + 1] = '1';
+         if ((z >> i) & 1) pats[j][3 * i + 2] = '1';
+      }
+   }
+   clock_t start = clock();
+   size_t ones = 0;
+   for (size_t j = 0; j < np; ++j) ones += bm.evalCube(f, pats[j]);
+   double base = cpuTime(start);
+   report("evalCube", 0, base, bm.getNumNodes());
+
+   BddCompiled comp(f);
+   start = clock();
+   size_t ones1 = 0;
+   for (size_t j = 0; j < np; ++j) ones1 += comp.eval(0, pats[j]);
+   report("BddCompiled::eval", base, cpuTime(start), comp.getNumNodes());
+   assert(ones == ones1);
+
+   // Pack the patterns into words
+   for (size_t nw = 1; nw <= 16; nw *= 16) {
+      size_t nb = (np + 64 * nw - 1) / (64 * nw);
+      vector<vector<unsigned long long> > words(nb,
+         vector<unsigned long long>((nin + 1) * nw, 0));
+      for (size_t j = 0; j < np; ++j)
+         for (int v = 1; v <= nin; ++v)
+            if (pats[j][v - 1] == '1')
+               words[j / (64 * nw)][v * nw + j % (64 * nw) / 64] |=
+                  1ULL << (j % 64);
+      start = clock();
+      size_t ones2 = 0;
+      vector<unsigned long long> res;
+      for (size_t k = 0; k < nb; ++k) {
+         bm.evalBatch(f, words[k], nw, res);
+         // The last batch may be partly filled
+         // ==> the zero patterns beyond np are masked off
+         for (size_t w = 0, j = k * 64 * nw; w < nw && j < np; ++w, j += 64)
+            ones2 += __builtin_popcountll(np - j >= 64? res[w] :
+                        res[w] & ((1ULL << (np - j)) - 1));
+      }
+      report(nw == 1? "evalBatch (64)" : "evalBatch (64 x 16)", base,
+             cpuTime(start), bm.getNumNodes());
+      assert(ones == ones2);
+   }
+   cout << "  #patterns with f = 1: " << ones << endl;
+}
+
+// ite(A, B, 0) for A = (x == y) and B = (x == z) of b-bit words, where
+// x, y and z are apart in the order, with 1 ~ n threads
+// ==> all on the parallel engine, so that 1 thread (i.e. no forking) is
+//     the baseline of the ratios
+// ==> in wall-clock time, as cpuTime() sums up all the threads
+// [Note] All the way up to n threads, even beyond the hardware ones
+//        (which are reported); those beyond only share the cores, and
+//        show the overhead of the engine rather than any speedup
+static void
+benchParallel(int n)
+{
+   const int b = 10;
+   cout << "[parallel] (x == y) & (x == z) of " << b << "-bit words, 1 ~ "
+        << n << " threads" << endl;
+#ifdef BDD_COMPACT_NODE
+   cout << "  (skipped: ite() is serial in BDD_COMPACT_NODE mode)" << endl;
+#else
+   const int nin = 3 * b;
+   cout << "  (" << thread::hardware_concurrency()
+        << " hardware thread(s))" << endl;
+   double base = 0;
+   for (int nt = 1; nt <= n; nt *= 2) {
+      BddMgr bm(nin, 1 << 16, 1 << 18);
+      // x[i], y[i], z[i] are variables i+1, b+i+1 and 2b+i+1
+      BddNode a = BddNode::_one, c = BddNode::_one;
+      for (int i = 1; i <= b; ++i) {
+         const BddNode& x = bm.getSupport(i);
+         a &= bm.bddXnor(x, bm.getSupport(b + i));
+         c &= bm.bddXnor(x, bm.getSupport(2 * b + i));
+      }
+      bm.setNumThreads(nt);
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      BddNode res = bm.ite(a, c, BddNode::_zero);
+      double t = chrono::duration<double>(
+         chrono::steady_clock::now() - start).count();
+      report(to_string(nt) + " thread(s)", base, t, bm.getNumNodes());
+      if (nt == 1) base = t;
+      assert(bm.satCountExact(res, nin) == BigNum::pow2(b));
+   }
+#endif
+}
+
+// Build the 7-queens on 1 ~ n threads at once, each with its own BddMgr
+static void
+benchManagers(int n)
+{
+   const int q = 7;
+   cout << "[managers] " << q << "-queens by 1 ~ " << n
+        << " independent BddMgrs" << endl;
+   double base = 0;
+   for (int nt = 1; nt <= n; nt *= 2) {
+      vector<size_t> sizes(nt);
+      vector<thread> threads;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (int i = 0; i < nt; ++i)
+         threads.push_back(thread([&sizes, i]() {
+            BddMgr bm(q * q, 1 << 14, 1 << 16);
+            BddNode res = queens(bm, q, false);
+            sizes[i] = bm.getNumNodes();
+            assert(bm.satCountExact(res, q * q) == BigNum(40));
+         }));
+      for (int i = 0; i < nt; ++i) threads[i].join();
+      double t = chrono::duration<double>(
+         chrono::steady_clock::now() - start).count();
+      report(to_string(nt) + " BddMgr(s)", base, t / nt, sizes[0]);
+      if (nt == 1) base = t;
+   }
+}
+
+// Print the 8-queens n times, on one thread and then split on 1 ~ 4
+// threads (one BddMgr shared by all)
+// [Note] The threads share the nodes, so BDD_COMPACT_NODE runs only one
+static void
+benchTraverse(int n)
+{
+   const int q = 8;
+   cout << "[traverse] print the " << q << "-queens " << n << " times"
+        << endl;
+   BddMgr bm(q * q, 1 << 14, 1 << 16);
+   BddNode res = queens(bm, q, false);
+   double base = 0;
+#ifdef BDD_COMPACT_NODE
+   for (int nt = 1; nt <= 1; nt *= 2) {
+#else
+   for (int nt = 1; nt <= 4; nt *= 2) {
+#endif
+      vector<size_t> lens(nt, 0);
+      vector<thread> threads;
+      chrono::steady_clock::time_point start = chrono::steady_clock::now();
+      for (int i = 0; i < nt; ++i)
+         threads.push_back(thread([&bm, &res, &lens, i, n, nt]() {
+            bm.makeCurrent();
+            for (int k = i; k < n; k += nt) {
+               ostringstream os;
+               os << res;
+               lens[i] += os.str().size();
+            }
+         }));
+      for (int i = 0; i < nt; ++i) threads[i].join();
+      double t = chrono::duration<double>(
+         chrono::steady_clock::now() - start).count();
+      report(to_string(nt) + " thread(s)", base, t, bm.getNumNodes());
+      if (nt == 1) base = t;
+   }
+   bm.makeCurrent();
+}
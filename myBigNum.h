@@ -0,0 +1,139 @@
+/****************************************************************************
+  FileName     [ myBigNum.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define unsigned arbitrary-precision integer ADT ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2009-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_BIG_NUM_H
+#define MY_BIG_NUM_H
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <cassert>
+
+using namespace std;
+
+//----------------------
+// Define BigNum classes
+//----------------------
+// An unsigned integer of any size, stored as 32-bit digits (the least
+// significant one first). Only the operations needed for counting are
+// supported: +, - (no negative result), << and comparison.
+//
+class BigNum
+{
+public:
+   BigNum(unsigned long long v = 0) {
+      for (; v; v >>= 32) _d.push_back(unsigned(v)); }
+
+   static BigNum pow2(size_t k) { BigNum b(1); return (b <<= k); }
+
+   bool isZero() const { return _d.empty(); }
+   // #significant bits
+   size_t numBits() const {
+      if (_d.empty()) return 0;
+      size_t n = (_d.size() - 1) * 32;
+      for (unsigned x = _d.back(); x; x >>= 1) ++n;
+      return n;
+   }
+
+   BigNum& operator += (const BigNum& b) {
+      if (_d.size() < b._d.size()) _d.resize(b._d.size(), 0);
+      unsigned long long c = 0;
+      for (size_t i = 0, n = _d.size(); i < n; ++i) {
+         if (i >= b._d.size() && c == 0) break;
+         c += (unsigned long long)_d[i] + (i < b._d.size()? b._d[i] : 0);
+         _d[i] = unsigned(c);
+         c >>= 32;
+      }
+      if (c) _d.push_back(unsigned(c));
+      return (*this);
+   }
+   // [Note] *this must >= b
+   BigNum& operator -= (const BigNum& b) {
+      assert(!(*this < b));
+      unsigned long long borrow = 0;
+      for (size_t i = 0, n = _d.size(); i < n; ++i) {
+         if (i >= b._d.size() && borrow == 0) break;
+         unsigned long long s = (i < b._d.size()? b._d[i] : 0) + borrow;
+         borrow = (_d[i] < s);
+         _d[i] = unsigned(_d[i] - s);
+      }
+      trim();
+      return (*this);
+   }
+   BigNum& operator <<= (size_t k) {
+      if (_d.empty()) return (*this);
+      if (unsigned s = k % 32) {
+         unsigned c = 0;
+         for (size_t i = 0, n = _d.size(); i < n; ++i) {
+            unsigned long long x = ((unsigned long long)_d[i] << s) | c;
+            _d[i] = unsigned(x);
+            c = unsigned(x >> 32);
+         }
+         if (c) _d.push_back(c);
+      }
+      _d.insert(_d.begin(), k / 32, 0);
+      return (*this);
+   }
+   BigNum operator + (const BigNum& b) const { BigNum r(*this); return r += b; }
+   BigNum operator - (const BigNum& b) const { BigNum r(*this); return r -= b; }
+   BigNum operator << (size_t k) const { BigNum r(*this); return r <<= k; }
+
+   bool operator == (const BigNum& b) const { return _d == b._d; }
+   bool operator != (const BigNum& b) const { return _d != b._d; }
+   bool operator < (const BigNum& b) const {
+      if (_d.size() != b._d.size()) return _d.size() < b._d.size();
+      for (size_t i = _d.size(); i-- > 0;)
+         if (_d[i] != b._d[i]) return _d[i] < b._d[i];
+      return false;
+   }
+
+   // in decimal
+   string str() const {
+      if (_d.empty()) return "0";
+      vector<unsigned> d(_d), parts;  // parts: base 10^9
+      while (!d.empty()) {
+         unsigned long long r = 0;
+         for (size_t i = d.size(); i-- > 0;) {
+            unsigned long long x = (r << 32) | d[i];
+            d[i] = unsigned(x / 1000000000);
+            r = x % 1000000000;
+         }
+         parts.push_back(unsigned(r));
+         while (!d.empty() && d.back() == 0) d.pop_back();
+      }
+      ostringstream os;
+      os << parts.back();
+      for (size_t i = parts.size() - 1; i-- > 0;)
+         os << setw(9) << setfill('0') << parts[i];
+      return os.str();
+   }
+   // [Note] Must fit in 64 bits, i.e. numBits() <= 64
+   unsigned long long toULL() const {
+      assert(numBits() <= 64);
+      unsigned long long r = 0;
+      for (size_t i = _d.size(); i-- > 0;) r = (r << 32) | _d[i];
+      return r;
+   }
+   long double toLongDouble() const {
+      long double r = 0;
+      for (size_t i = _d.size(); i-- > 0;) r = r * 4294967296.0L + _d[i];
+      return r;
+   }
+
+   friend ostream& operator << (ostream& os, const BigNum& b) {
+      return os << b.str(); }
+
+private:
+   vector<unsigned>   _d;
+
+   void trim() { while (!_d.empty() && _d.back() == 0) _d.pop_back(); }
+};
+
+#endif // MY_BIG_NUM_H
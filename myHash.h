@@ -1,7 +1,8 @@
 /****************************************************************************
   FileName     [ myHash.h ]
   PackageName  [ util ]
-  Synopsis     [ Define Hash and Cache ADT ]
+  Synopsis     [ Define Hash, OpenHash, Cache, AssocCache, LossyCache and
+                 LockFreeHash ADT ]
   Author       [ Chung-Yang (Ric) Huang ]
   Copyright    [ Copyleft(c) 2009-present LaDs(III), GIEE, NTU, Taiwan ]
 ****************************************************************************/
@@ -10,6 +11,8 @@
 #define MY_HASH_H
 
 #include <vector>
+#include <atomic>
+#include <cassert>
 
 using namespace std;
 
@@ -193,6 +196,189 @@ private:
 };
 
 
+//------------------------
+// Define OpenHash classes
+//------------------------
+// OpenHash is a flat, open-addressed (linear probing) hash table.
+// Unlike Hash, there is no per-bucket vector; all the HashNodes are stored
+// in one array, and the array is doubled whenever the load factor exceeds
+// _maxLoad. Therefore there is no need to guess the size in init().
+//
+// The HashKey class is the same as that of Hash, but its "()" should be a
+// well mixed number because the low bits are used as the slot index.
+//
+// [Note] HashData(0) is reserved to denote an empty slot.
+//
+template <class HashKey, class HashData>
+class OpenHash
+{
+typedef pair<HashKey, HashData> HashNode;
+
+public:
+   OpenHash() : _numSlots(0), _mask(0), _size(0), _slots(0), _maxLoad(0.7) {}
+   OpenHash(size_t b) : _numSlots(0), _mask(0), _size(0), _slots(0),
+      _maxLoad(0.7) { init(b); }
+   ~OpenHash() { reset(); }
+
+   // Go through all the valid HashNodes
+   class iterator
+   {
+      friend class OpenHash<HashKey, HashData>;
+
+   public:
+      iterator(OpenHash<HashKey, HashData>* h = 0, size_t s = 0)
+      : _hash(h), _sId(s) {}
+      iterator(const iterator& i) : _hash(i._hash), _sId(i._sId) {}
+      ~iterator() {} // Should NOT delete HashData
+
+      const HashNode& operator * () const { return _hash->_slots[_sId]; }
+      HashNode& operator * () { return _hash->_slots[_sId]; }
+      iterator& operator ++ () {
+         if (_hash == 0) return (*this);
+         while (++_sId < _hash->_numSlots && !_hash->isUsed(_sId));
+         return (*this);
+      }
+      iterator operator ++ (int) { iterator li=(*this); ++(*this); return li; }
+
+      iterator& operator = (const iterator& i) {
+         _hash = i._hash; _sId = i._sId; return (*this); }
+
+      bool operator != (const iterator& i) const { return !(*this == i); }
+      bool operator == (const iterator& i) const {
+         return (_hash == i._hash && _sId == i._sId); }
+
+   private:
+      OpenHash<HashKey, HashData>*   _hash;
+      size_t                         _sId;
+   };
+
+   iterator begin() const {
+      size_t i = 0;
+      while (i < _numSlots && !isUsed(i)) ++i;
+      return iterator(const_cast<OpenHash<HashKey, HashData>*>(this), i);
+   }
+   iterator end() const {
+      return iterator(const_cast<OpenHash<HashKey, HashData>*>(this),
+             _numSlots);
+   }
+   bool empty() const { return (_size == 0); }
+   size_t size() const { return _size; }
+   size_t numBuckets() const { return _numSlots; }
+   double loadFactor() const {
+      return _numSlots? double(_size) / _numSlots : 0; }
+   void setMaxLoad(double l) { assert(l > 0 && l < 1); _maxLoad = l; }
+
+   // b is only an initial hint; it will be rounded up to a power of 2
+   void init(size_t b) {
+      reset();
+      _numSlots = 8;
+      while (_numSlots < b) _numSlots <<= 1;
+      _mask = _numSlots - 1;
+      _slots = new HashNode[_numSlots];
+   }
+   void reset() {
+      _numSlots = _mask = _size = 0;
+      if (_slots) { delete [] _slots; _slots = 0; }
+   }
+
+   // check if k is in the hash...
+   // if yes, update n and return true;
+   // else return false;
+   bool check(const HashKey& k, HashData& n) const {
+      for (size_t i = slotNum(k); isUsed(i); i = (i + 1) & _mask)
+         if (_slots[i].first == k) {
+            n = _slots[i].second;
+            return true;
+         }
+      return false;
+   }
+
+   // return true if inserted successfully (i.e. k is not in the hash)
+   // return false is k is already in the hash ==> will not insert
+   bool insert(const HashKey& k, const HashData& d) {
+      size_t i = slotNum(k);
+      for (; isUsed(i); i = (i + 1) & _mask)
+         if (_slots[i].first == k)
+            return false;
+      return fillSlot(i, k, d);
+   }
+
+   // return true if inserted successfully (i.e. k is not in the hash)
+   // return false is k is already in the hash ==> still do the insertion
+   bool replaceInsert(const HashKey& k, const HashData& d) {
+      size_t i = slotNum(k);
+      for (; isUsed(i); i = (i + 1) & _mask)
+         if (_slots[i].first == k) {
+            _slots[i].second = d;
+            return false;
+         }
+      return fillSlot(i, k, d);
+   }
+
+   // Need to be sure that k is not in the hash
+   void forceInsert(const HashKey& k, const HashData& d) {
+      size_t i = slotNum(k);
+      while (isUsed(i)) i = (i + 1) & _mask;
+      fillSlot(i, k, d);
+   }
+
+   // return false if k is not in the hash
+   // [Note] The later HashNodes in the same cluster are shifted backward,
+   //        so there is no need for tombstones.
+   bool remove(const HashKey& k) {
+      size_t i = slotNum(k);
+      for (; isUsed(i); i = (i + 1) & _mask)
+         if (_slots[i].first == k) break;
+      if (!isUsed(i)) return false;
+      for (size_t j = (i + 1) & _mask; isUsed(j); j = (j + 1) & _mask) {
+         // move _slots[j] to the hole at i if its home is not in (i, j]
+         size_t h = slotNum(_slots[j].first);
+         if (((j - h) & _mask) >= ((j - i) & _mask)) {
+            _slots[i] = _slots[j];
+            i = j;
+         }
+      }
+      _slots[i].second = HashData(0);
+      --_size;
+      return true;
+   }
+
+private:
+   size_t           _numSlots;   // always a power of 2
+   size_t           _mask;
+   size_t           _size;
+   HashNode*        _slots;
+   double           _maxLoad;
+
+   bool isUsed(size_t i) const { return _slots[i].second != HashData(0); }
+   size_t slotNum(const HashKey& k) const { return (k() & _mask); }
+
+   // return true for the convenience of insert()
+   bool fillSlot(size_t i, const HashKey& k, const HashData& d) {
+      assert(d != HashData(0));
+      _slots[i].first = k;
+      _slots[i].second = d;
+      if (++_size > _maxLoad * _numSlots) resize(_numSlots << 1);
+      return true;
+   }
+   void resize(size_t s) {
+      HashNode* oldSlots = _slots;
+      size_t oldNum = _numSlots;
+      _numSlots = s; _mask = s - 1;
+      _slots = new HashNode[s];
+      for (size_t i = 0; i < oldNum; ++i) {
+         if (oldSlots[i].second == HashData(0)) continue;
+         size_t j = slotNum(oldSlots[i].first);
+         while (isUsed(j)) j = (j + 1) & _mask;
+         _slots[j] = oldSlots[i];
+      }
+      delete [] oldSlots;
+   }
+   // OpenHash is not copyable
+   OpenHash(const OpenHash&);
+   OpenHash& operator = (const OpenHash&);
+};
+
 //---------------------
 // Define Cache classes
 //---------------------
@@ -257,4 +443,312 @@ private:
 };
 
 
+//--------------------------
+// Define AssocCache classes
+//--------------------------
+// AssocCache is a set-associative Cache with (#ways = ASSOC_CACHE_WAYS).
+// Within a set, the entries are kept in the most-recently-used order, so
+// the least-recently-used one is replaced on a miss.
+//
+// The CacheKey class is the same as that of Cache, except that:
+// (1) its "()" should be well mixed (the low bits are used as the set no.)
+// (2) CacheKey() denotes an empty entry, and is never read or written.
+//
+// The cache doubles itself (up to _maxSize entries) when, within the last
+// window of size() accesses, the hit rate drops under ASSOC_CACHE_MIN_HIT
+// while most of the writes evict valid entries (i.e. it is under load).
+//
+#define ASSOC_CACHE_WAYS      4
+#define ASSOC_CACHE_MIN_HIT   0.5
+
+template <class CacheKey, class CacheData>
+class AssocCache
+{
+typedef pair<CacheKey, CacheData> CacheNode;
+
+public:
+   AssocCache() : _numSets(0), _maxSize(0), _cache(0) { resetStats(); }
+   AssocCache(size_t s, size_t m = 0) : _numSets(0), _maxSize(0), _cache(0)
+   { init(s, m); }
+   ~AssocCache() { reset(); }
+
+   // Initialize with (at least) s entries; can grow up to m entries
+   void init(size_t s, size_t m = 0) {
+      reset();
+      _numSets = 1;
+      while (_numSets * ASSOC_CACHE_WAYS < s) _numSets <<= 1;
+      _maxSize = (m > size())? m : size();
+      _cache = new CacheNode[size()];
+   }
+   void reset() {
+      _numSets = 0;
+      if (_cache) { delete [] _cache; _cache = 0; }
+      resetStats();
+   }
+   void resetStats() {
+      _numHits = _numMisses = _numEvictions = _numResizes = 0;
+      _winAccess = _winHits = _winEvictions = 0;
+   }
+   // Invalidate all the entries; the size is kept
+   void clear() {
+      for (size_t i = 0, n = size(); i < n; ++i) _cache[i] = CacheNode();
+   }
+
+   // #entries
+   size_t size() const { return _numSets * ASSOC_CACHE_WAYS; }
+   size_t maxSize() const { return _maxSize; }
+   void setMaxSize(size_t m) { if (m > _maxSize) _maxSize = m; }
+
+   // Statistics
+   size_t numHits() const { return _numHits; }
+   size_t numMisses() const { return _numMisses; }
+   size_t numEvictions() const { return _numEvictions; }
+   size_t numResizes() const { return _numResizes; }
+   double hitRate() const {
+      size_t n = _numHits + _numMisses;
+      return n? double(_numHits) / n : 0; }
+
+   // To go through all the entries (e.g. to invalidate some of them)
+   CacheNode& operator [] (size_t i) { return _cache[i]; }
+   const CacheNode& operator [](size_t i) const { return _cache[i]; }
+
+   // return false if cache miss
+   bool read(const CacheKey& k, CacheData& d) {
+      CacheNode* set = getSet(k);
+      for (unsigned i = 0; i < ASSOC_CACHE_WAYS; ++i)
+         if (set[i].first == k) {
+            d = set[i].second;
+            if (i != 0) moveToFront(set, i, set[i]);
+            ++_numHits; ++_winHits;
+            checkWindow();
+            return true;
+         }
+      ++_numMisses;
+      checkWindow();
+      return false;
+   }
+   // If k is already in the Cache, overwrite the CacheData; otherwise
+   // take the first empty way (e.g. a hole left by an invalidation),
+   // or evict the LRU one
+   // ==> k is looked for in all the ways first, so it never has two
+   //     copies in the set
+   void write(const CacheKey& k, const CacheData& d) {
+      CacheNode* set = getSet(k);
+      unsigned i = 0;
+      for (; i < ASSOC_CACHE_WAYS; ++i)
+         if (set[i].first == k) break;
+      if (i == ASSOC_CACHE_WAYS) {
+         for (i = 0; i < ASSOC_CACHE_WAYS - 1; ++i)
+            if (set[i].first == CacheKey()) break;
+         if (!(set[i].first == CacheKey())) {
+            ++_numEvictions; ++_winEvictions;
+         }
+      }
+      moveToFront(set, i, CacheNode(k, d));
+   }
+
+private:
+   size_t         _numSets;    // always a power of 2
+   size_t         _maxSize;    // in #entries
+   CacheNode*     _cache;
+
+   size_t         _numHits;
+   size_t         _numMisses;
+   size_t         _numEvictions;
+   size_t         _numResizes;
+   size_t         _winAccess;
+   size_t         _winHits;
+   size_t         _winEvictions;
+
+   CacheNode* getSet(const CacheKey& k) const {
+      return _cache + (k() & (_numSets - 1)) * ASSOC_CACHE_WAYS; }
+   // Move set[0, i) one way down and put n at set[0]
+   void moveToFront(CacheNode* set, unsigned i, CacheNode n) {
+      for (; i > 0; --i) set[i] = set[i - 1];
+      set[0] = n;
+   }
+   void checkWindow() {
+      if (++_winAccess < size()) return;
+      if (size() < _maxSize &&
+          _winHits < ASSOC_CACHE_MIN_HIT * _winAccess &&
+          _winEvictions * 2 > _winAccess - _winHits)
+         resize(_numSets << 1);
+      _winAccess = _winHits = _winEvictions = 0;
+   }
+   // Re-insert the old entries from LRU to MRU to keep their order
+   void resize(size_t ns) {
+      CacheNode* oldCache = _cache;
+      size_t oldSize = size();
+      _numSets = ns;
+      _cache = new CacheNode[size()];
+      for (size_t i = 0; i < oldSize; i += ASSOC_CACHE_WAYS)
+         for (unsigned j = ASSOC_CACHE_WAYS; j > 0; --j) {
+            const CacheNode& n = oldCache[i + j - 1];
+            if (!(n.first == CacheKey()))
+               moveToFront(getSet(n.first), ASSOC_CACHE_WAYS - 1, n);
+         }
+      delete [] oldCache;
+      ++_numResizes;
+   }
+   // AssocCache is not copyable
+   AssocCache(const AssocCache&);
+   AssocCache& operator = (const AssocCache&);
+};
+
+
+//--------------------------
+// Define LossyCache classes
+//--------------------------
+// LossyCache is a direct-mapped Cache that can be shared by threads.
+// Every entry has its own spin lock, which is only tried, never waited:
+// a read (write) that finds the entry locked by another thread is taken
+// as a miss (is dropped).
+// ==> A reader never gets a torn entry, and no thread ever blocks, but
+//     an entry may be lost at any time; fine for a computed table.
+//
+// The CacheKey class is the same as that of AssocCache.
+//
+template <class CacheKey, class CacheData>
+class LossyCache
+{
+   struct CacheNode {
+      CacheNode() : _lock(false), _data() {}
+      atomic<bool>   _lock;
+      CacheKey       _key;
+      CacheData      _data;
+   };
+
+public:
+   LossyCache() : _size(0), _cache(0) {}
+   ~LossyCache() { reset(); }
+
+   // Initialize with (at least) s entries
+   void init(size_t s) {
+      reset();
+      for (_size = 1; _size < s; _size <<= 1);
+      _cache = new CacheNode[_size];
+   }
+   void reset() {
+      _size = 0;
+      if (_cache) { delete [] _cache; _cache = 0; }
+   }
+
+   size_t size() const { return _size; }
+
+   // To go through all the entries (e.g. to invalidate some of them)
+   // [Note] Not thread-safe
+   CacheKey& key(size_t i) { return _cache[i]._key; }
+   CacheData& data(size_t i) { return _cache[i]._data; }
+
+   // return false if cache miss, or the entry is busy
+   bool read(const CacheKey& k, CacheData& d) {
+      CacheNode& n = _cache[k() & (_size - 1)];
+      if (n._lock.exchange(true, memory_order_acquire)) return false;
+      bool hit = (n._key == k);
+      if (hit) d = n._data;
+      n._lock.store(false, memory_order_release);
+      return hit;
+   }
+   // Overwrite the entry, unless it is busy
+   void write(const CacheKey& k, const CacheData& d) {
+      CacheNode& n = _cache[k() & (_size - 1)];
+      if (n._lock.exchange(true, memory_order_acquire)) return;
+      n._key = k;
+      n._data = d;
+      n._lock.store(false, memory_order_release);
+   }
+
+private:
+   size_t         _size;       // always a power of 2
+   CacheNode*     _cache;
+
+   // LossyCache is not copyable
+   LossyCache(const LossyCache&);
+   LossyCache& operator = (const LossyCache&);
+};
+
+//----------------------------
+// Define LockFreeHash classes
+//----------------------------
+// LockFreeHash is a fixed-size, insert-only hash of non-zero size_t data
+// (e.g. the addresses of some objects), shared by threads without any
+// lock: a datum is published by a CAS on an empty slot, and stays in its
+// slot until clear() (which is not thread-safe).
+// The key is not stored; it is taken from the datum by the KeyOf functor,
+// i.e. KeyOf()(d) returns the HashKey of d
+// ==> one word per slot
+//
+// A key is probed in the window of LOCK_FREE_HASH_PROBES slots from its
+// hash; as the slots never become empty, a key whose window is full of
+// the others can never be inserted, which insert() reports to all the
+// threads alike (e.g. to take a locked table instead)
+//
+// The HashKey class is the same as that of OpenHash.
+//
+#define LOCK_FREE_HASH_PROBES  64
+
+template <class HashKey, class KeyOf>
+class LockFreeHash
+{
+public:
+   LockFreeHash() : _size(0), _slots(0) {}
+   ~LockFreeHash() { reset(); }
+
+   // Initialize with (at least) s slots, all empty
+   void init(size_t s) {
+      reset();
+      for (_size = LOCK_FREE_HASH_PROBES; _size < s; _size <<= 1);
+      _slots = new atomic<size_t>[_size];
+      for (size_t i = 0; i < _size; ++i)
+         _slots[i].store(0, memory_order_relaxed);
+   }
+   void reset() {
+      _size = 0;
+      if (_slots) { delete [] _slots; _slots = 0; }
+   }
+
+   size_t size() const { return _size; }
+
+   // return the datum of k; 0 if not found
+   size_t find(const HashKey& k) const {
+      for (size_t i = 0, s = k(); i < LOCK_FREE_HASH_PROBES; ++i) {
+         size_t d = _slots[(s + i) & (_size - 1)].load(memory_order_acquire);
+         if (d == 0 || KeyOf()(d) == k) return d;
+      }
+      return 0;
+   }
+   // Insert d (!= 0, whose key is k) to slot i, unless k is in already
+   // ==> return d if inserted; the datum of k if found; 0 if neither
+   //     (i.e. the window of k is full)
+   // [Note] Everything written to *d happens before the other threads
+   //        find d
+   size_t insert(const HashKey& k, size_t d, size_t& i) {
+      assert(d != 0);
+      for (size_t j = 0, s = k(); j < LOCK_FREE_HASH_PROBES; ++j) {
+         i = (s + j) & (_size - 1);
+         size_t e = _slots[i].load(memory_order_acquire);
+         if (e == 0 && _slots[i].compare_exchange_strong(e, d,
+                          memory_order_acq_rel, memory_order_acquire))
+            return d;
+         // e is the datum taken by another thread otherwise
+         if (KeyOf()(e) == k) return e;
+      }
+      return 0;
+   }
+
+   // To go through the inserted data by their slots
+   // [Note] Not thread-safe
+   size_t data(size_t i) const {
+      return _slots[i].load(memory_order_relaxed); }
+   void clear(size_t i) { _slots[i].store(0, memory_order_relaxed); }
+
+private:
+   size_t            _size;       // always a power of 2
+   atomic<size_t>*   _slots;
+
+   // LockFreeHash is not copyable
+   LockFreeHash(const LockFreeHash&);
+   LockFreeHash& operator = (const LockFreeHash&);
+};
+
 #endif // MY_HASH_H
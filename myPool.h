@@ -0,0 +1,189 @@
+/****************************************************************************
+  FileName     [ myPool.h ]
+  PackageName  [ util ]
+  Synopsis     [ Define chunked memory pool ADT ]
+  Author       [ Chung-Yang (Ric) Huang ]
+  Copyright    [ Copyleft(c) 2009-present LaDs(III), GIEE, NTU, Taiwan ]
+****************************************************************************/
+
+#ifndef MY_POOL_H
+#define MY_POOL_H
+
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+
+using namespace std;
+
+#define POOL_LINE_SIZE   64
+#define POOL_CHUNK_SIZE  4096
+
+//--------------------
+// Define Pool classes
+//--------------------
+// Pool<T> hands out raw, uninitialized memory for objects of type T.
+// Objects are carved out of large chunks (each aligned to a cache line)
+// so that they are contiguous in memory. A freed object is put on an
+// intrusive free list (i.e. its own storage holds the "next" link) and
+// will be recycled by the next alloc().
+//
+// Every object also has an index (chunk# * chunkSize + offset), so that
+// a user can refer to it with a small integer instead of a pointer.
+// ==> Use either alloc()/free() or allocIndex()/freeIndex() on a Pool;
+//     do not mix them.
+// ==> Index 0 is reserved (never allocated) so that 0 can denote "null".
+//
+// The first slot of every chunk holds the tag of the Pool (e.g. its
+// owner; see setTag()) and the chunk#, and every chunk is aligned to its
+// size rounded up to a power of 2, so tagOf() and indexOf() are O(1).
+// ==> sizeof(T) >= sizeof(void*) + sizeof(size_t)
+//
+// [Note] Pool never calls the constructor/destructor of T.
+//        ==> use placement new after alloc(), and call ~T() before free()
+//            if it matters.
+//        ==> reset() releases all the chunks at once, in O(#chunks).
+//
+template <class T>
+class Pool
+{
+   struct FreeNode { FreeNode* _next; };
+   // _alignBits: log2 of the chunk alignment, for tagOf() to check its cs
+   struct ChunkHead { void* _tag; unsigned _chunk; unsigned _alignBits; };
+
+public:
+   // cs will be rounded up to a power of 2
+   Pool(size_t cs = POOL_CHUNK_SIZE) : _numUsed(0), _freeList(0),
+      _freeIdx(0), _curr(0), _end(0), _tag(0) { setChunkSize(cs); }
+   ~Pool() { reset(); }
+
+   void init(size_t cs) { reset(); setChunkSize(cs); }
+   void reset() {
+      for (size_t i = 0, n = _chunks.size(); i < n; ++i)
+         ::free(_chunks[i]);
+      _chunks.clear();
+      _numUsed = 0; _freeList = 0; _freeIdx = 0; _curr = _end = 0;
+   }
+
+   T* alloc() {
+      ++_numUsed;
+      if (_freeList) {
+         T* p = (T*)_freeList;
+         _freeList = _freeList->_next;
+         return p;
+      }
+      if (_curr == _end) newChunk();
+      return _curr++;
+   }
+   void free(T* p) {
+      assert(_numUsed > 0);
+      --_numUsed;
+      FreeNode* f = (FreeNode*)p;
+      f->_next = _freeList;
+      _freeList = f;
+   }
+
+   // The free list is linked by indices (stored in the first size_t)
+   size_t allocIndex() {
+      ++_numUsed;
+      if (_freeIdx) {
+         size_t i = _freeIdx;
+         _freeIdx = *(size_t*)at(i);
+         return i;
+      }
+      if (_curr == _end) newChunk();
+      return ((_chunks.size() - 1) << _shift) + (_curr++ - lastChunk());
+   }
+   void freeIndex(size_t i) {
+      assert(_numUsed > 0 && i != 0);
+      --_numUsed;
+      *(size_t*)at(i) = _freeIdx;
+      _freeIdx = i;
+   }
+
+   T* at(size_t i) const { return (T*)_chunks[i >> _shift] + (i & _mask); }
+   size_t indexOf(const T* p) const {
+      const T* c = (const T*)(size_t(p) & ~(_align - 1));
+      return (size_t(((const ChunkHead*)c)->_chunk) << _shift) + (p - c);
+   }
+
+   void setTag(void* t) {
+      _tag = t;
+      for (size_t i = 0, n = _chunks.size(); i < n; ++i)
+         ((ChunkHead*)_chunks[i])->_tag = t;
+   }
+   void* getTag() const { return _tag; }
+   // p must be allocated by a Pool of chunk size cs
+   // ==> static, so the Pool of p need not be known; cs is thus given
+   //     by the caller (no default), and checked against the chunk head
+   static void* tagOf(const T* p, size_t cs) {
+      size_t a = chunkAlign(chunkBytes(roundChunkSize(cs)));
+      const ChunkHead* h = (const ChunkHead*)(size_t(p) & ~(a - 1));
+      assert((size_t(1) << h->_alignBits) == a);
+      return h->_tag;
+   }
+
+   // number of objects in use
+   size_t size() const { return _numUsed; }
+   size_t numChunks() const { return _chunks.size(); }
+   // #objects in the chunks (i.e. all the indices < capacity())
+   size_t capacity() const { return _chunks.size() << _shift; }
+   size_t chunkSize() const { return _mask + 1; }
+   // in bytes
+   size_t memUsage() const { return _chunks.size() * chunkBytes(); }
+
+private:
+   unsigned           _shift;       // chunkSize = (1 << _shift)
+   size_t             _mask;
+   size_t             _align;       // of the chunks
+   size_t             _numUsed;
+   FreeNode*          _freeList;
+   size_t             _freeIdx;
+   T*                 _curr;        // next fresh slot in the last chunk
+   T*                 _end;
+   vector<void*>      _chunks;
+   void*              _tag;
+
+   static size_t roundChunkSize(size_t cs) {
+      size_t n = 2;
+      while (n < cs) n <<= 1;
+      return n;
+   }
+   static size_t chunkBytes(size_t cs) {
+      size_t b = cs * sizeof(T);
+      return (b + POOL_LINE_SIZE - 1) / POOL_LINE_SIZE * POOL_LINE_SIZE;
+   }
+   static size_t chunkAlign(size_t b) {
+      size_t a = POOL_LINE_SIZE;
+      while (a < b) a <<= 1;
+      return a;
+   }
+   void setChunkSize(size_t cs) {
+      assert(sizeof(T) >= sizeof(ChunkHead));
+      for (_shift = 1; (size_t(1) << _shift) < cs; ++_shift);
+      _mask = (size_t(1) << _shift) - 1;
+      _align = chunkAlign(chunkBytes());
+   }
+   size_t chunkBytes() const { return chunkBytes(chunkSize()); }
+   T* lastChunk() const { return (T*)_chunks.back(); }
+   // [Note] The memory beyond chunkBytes(), up to the alignment, is not
+   //        taken (posix_memalign() returns it to the heap)
+   void newChunk() {
+      void* c = 0;
+      int r = posix_memalign(&c, _align, chunkBytes());
+      assert(r == 0 && c != 0); (void)r;
+      // slot 0 holds the ChunkHead (and index 0 is thus reserved)
+      ChunkHead* h = (ChunkHead*)c;
+      h->_tag = _tag;
+      h->_chunk = _chunks.size();
+      for (h->_alignBits = 0; (size_t(1) << h->_alignBits) < _align;
+           ++h->_alignBits);
+      _chunks.push_back(c);
+      _curr = (T*)c + 1;
+      _end = (T*)c + chunkSize();
+   }
+   // Pool is not copyable
+   Pool(const Pool&);
+   Pool& operator = (const Pool&);
+};
+
+#endif // MY_POOL_H
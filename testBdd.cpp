@@ -7,9 +7,15 @@
 ****************************************************************************/
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <string>
 #include <cstdlib>
+#include <cmath>
+#include <new>
+#include <set>
 #include "bddNode.h"
 #include "bddMgr.h"
+#include "bddCompiled.h"
 
 using namespace std;
 
@@ -22,13 +28,61 @@ BddMgr bm;
 /*                    Define Static Function Prototypes                   */
 /**************************************************************************/
 static void initBdd(size_t nSupports, size_t hashSize, size_t cacheSize);
+static void demo();
+static unsigned runTests();
+static void check(bool ok, const string& what);
+static BddNode randomBdd(BddMgr& bm, unsigned& seed, size_t nOps,
+                         size_t nVars = 0);
+static string toPattern(size_t nin, size_t p);
+static string truthTable(BddMgr& bm, const BddNode& f);
+static bool sameTruthTable(BddMgr& bm, const BddNode& f, const BddNode& g);
+static BddNode cubeBdd(BddMgr& bm, const string& cube);
+static void checkCubeIter(BddMgr& bm, const BddNode& f);
+static void testPool();
+static void testGc();
+static void testRefCount();
+static void testCache();
+static void testApply();
+static void testIterativeIte();
+static void testParallel();
+static void testReorder();
+static void testAutoReorder();
+static void testLevels();
+static void testNodeMove();
+static void testTraverse();
+static void testQuantify();
+static void testAndExists();
+static void testCompose();
+static void testGenCofactor();
+static void testCountCube();
+static void testSatCount();
+static void testProbability();
+static void testEvalBatch();
+static void testSampler();
+static void testCompiled();
+static void testIsop();
+static void testManagers();
 
 
 /**************************************************************************/
 /*                             Define main()                              */
 /**************************************************************************/
+// testBdd       ==> the demo below
+// testBdd test  ==> the functional tests; return #failures
 int
-main()
+main(int argc, char** argv)
+{
+   if (argc > 1 && string(argv[1]) == "test")
+      return runTests() != 0;
+   demo();
+}
+
+
+/**************************************************************************/
+/*                          Define Static Functions                       */
+/**************************************************************************/
+static void
+demo()
 {
    initBdd(5, 127, 61);
 
@@ -73,10 +127,6 @@ main()
    /*----------- END OF TEST CODE ------------*/
 }
 
-
-/**************************************************************************/
-/*                          Define Static Functions                       */
-/**************************************************************************/
 static void
 initBdd(size_t nin, size_t h, size_t c)
 {
@@ -87,3 +137,1222 @@ initBdd(size_t nin, size_t h, size_t c)
    bm.init(nin, h, c);
 }
 
+//----------------------------------------------------------------------
+//    Functional tests
+//----------------------------------------------------------------------
+// Every test runs on a BddMgr of its own, made current over the global
+// one, and checks the results against an independent reference (e.g. the
+// truth tables by evalCube())
+// [Note] check() instead of assert(), so the tests also run with -DNDEBUG
+//
+static unsigned numFails = 0;
+
+static unsigned
+runTests()
+{
+   testPool();
+   testGc();
+   testRefCount();
+   testCache();
+   testApply();
+   testIterativeIte();
+   testParallel();
+   testReorder();
+   testAutoReorder();
+   testLevels();
+   testNodeMove();
+   testTraverse();
+   testQuantify();
+   testAndExists();
+   testCompose();
+   testGenCofactor();
+   testCountCube();
+   testSatCount();
+   testProbability();
+   testEvalBatch();
+   testSampler();
+   testCompiled();
+   testIsop();
+   testManagers();
+
+   if (numFails) cout << "==> " << numFails << " check(s) FAILED" << endl;
+   else cout << "==> All tests passed" << endl;
+   return numFails;
+}
+
+static void
+check(bool ok, const string& what)
+{
+   if (ok) return;
+   ++numFails;
+   cout << "  FAILED: " << what << endl;
+}
+
+// Apply nOps random AND/OR/XOR/NOT to the variables 1 ~ nVars of bm
+// (all the variables if nVars = 0)
+static BddNode
+randomBdd(BddMgr& bm, unsigned& seed, size_t nOps, size_t nVars)
+{
+   size_t nin = nVars? nVars : bm.getNumSupports() - 1;
+   vector<BddNode> fs;
+   for (size_t i = 1; i <= nin; ++i) fs.push_back(bm.getSupport(i));
+   for (size_t i = 0; i < nOps; ++i) {
+      seed = seed * 1103515245 + 12345;
+      const BddNode& a = fs[(seed >> 8) % fs.size()];
+      const BddNode& b = fs[(seed >> 16) % fs.size()];
+      switch ((seed >> 4) % 4) {
+         case 0: fs.push_back(a & b); break;
+         case 1: fs.push_back(a | b); break;
+         case 2: fs.push_back(a ^ b); break;
+         default: fs.push_back(~a); break;
+      }
+   }
+   return fs.back();
+}
+
+// Pattern p for evalCube(), i.e. the value of variable v is bit (v-1)
+static string
+toPattern(size_t nin, size_t p)
+{
+   string s(nin, '0');
+   for (size_t v = 0; v < nin; ++v)
+      if (p & (size_t(1) << v)) s[v] = '1';
+   return s;
+}
+
+// f on all the 2^nin patterns, as a string of '0' and '1'
+static string
+truthTable(BddMgr& bm, const BddNode& f)
+{
+   size_t nin = bm.getNumSupports() - 1;
+   string t(size_t(1) << nin, '0');
+   for (size_t p = 0; p < t.size(); ++p)
+      if (bm.evalCube(f, toPattern(nin, p)) == 1) t[p] = '1';
+   return t;
+}
+
+static bool
+sameTruthTable(BddMgr& bm, const BddNode& f, const BddNode& g)
+{
+   return truthTable(bm, f) == truthTable(bm, g);
+}
+
+// The cube of a pattern of BddCubeIter (i.e. '1', '0' or '-' for each
+// variable)
+static BddNode
+cubeBdd(BddMgr& bm, const string& cube)
+{
+   BddNode c = BddNode::_one;
+   for (size_t v = 1; v <= cube.size(); ++v)
+      if (cube[v - 1] == '1') c &= bm.getSupport(v);
+      else if (cube[v - 1] == '0') c &= ~bm.getSupport(v);
+   return c;
+}
+
+// The keys of a LockFreeHash in testParallel(), all in slot 0
+class SameSlotKey
+{
+public:
+   SameSlotKey(size_t v = 0) : _v(v) {}
+
+   size_t operator() () const { return 0; }
+   bool operator == (const SameSlotKey& k) const { return _v == k._v; }
+
+private:
+   size_t     _v;
+};
+
+struct SameSlotKeyOf
+{
+   SameSlotKey operator () (size_t d) const { return SameSlotKey(d); }
+};
+
+// Pool<T> on its own, with a chunk size (16) other than POOL_CHUNK_SIZE
+// ==> 15 objects per chunk, as slot 0 holds the chunk head
+static void
+testPool()
+{
+   cout << "[test] pool" << endl;
+   struct Obj { size_t _a, _b, _c; };
+   const size_t cs = 16;
+   int tag = 0;
+   Pool<Obj> p(cs);
+   p.setTag(&tag);
+   vector<Obj*> objs;
+   for (int i = 0; i < 40; ++i) objs.push_back(p.alloc());
+   check(p.size() == 40 && p.numChunks() == 3, "alloc() fills the chunks");
+   bool ok = true;
+   set<size_t> idxs;
+   for (size_t i = 0; i < objs.size(); ++i) {
+      size_t j = p.indexOf(objs[i]);
+      ok = ok && j != 0 && j < p.capacity() && p.at(j) == objs[i] &&
+           Pool<Obj>::tagOf(objs[i], cs) == &tag;
+      idxs.insert(j);
+   }
+   check(ok && idxs.size() == objs.size(), "indexOf(), at() and tagOf()");
+   set<Obj*> freed(objs.begin(), objs.begin() + 10), again;
+   for (int i = 0; i < 10; ++i) p.free(objs[i]);
+   check(p.size() == 30, "free()");
+   for (int i = 0; i < 10; ++i) again.insert(p.alloc());
+   check(again == freed && p.numChunks() == 3, "alloc() recycles");
+   p.reset();
+   check(p.size() == 0 && p.numChunks() == 0 && p.capacity() == 0,
+         "reset()");
+
+   Pool<Obj> q(cs);
+   vector<size_t> is;
+   for (int i = 0; i < 20; ++i) is.push_back(q.allocIndex());
+   ok = true;
+   for (size_t i = 0; i < is.size(); ++i)
+      ok = ok && is[i] != 0 && (i == 0 || is[i] > is[i - 1]);
+   check(ok && q.numChunks() == 2, "allocIndex() skips index 0");
+   q.freeIndex(is[3]);
+   q.freeIndex(is[7]);
+   size_t a = q.allocIndex(), b = q.allocIndex();
+   check(a == is[7] && b == is[3] && q.size() == 20, "freeIndex() recycles");
+}
+
+static void
+testGc()
+{
+   cout << "[test] garbage collection" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   bm.setGcThreshold(0);
+   unsigned seed = 1;
+   BddNode keep = randomBdd(bm, seed, 40);
+   BddNode copy = keep;
+   {
+      BddNode tmp = randomBdd(bm, seed, 40);
+   }
+   size_t nDead = bm.getNumDeadNodes();
+   check(nDead > 0, "dropped BDDs leave dead nodes");
+   size_t nLive = bm.getNumLiveNodes();
+   check(bm.garbageCollect() == nDead, "GC reclaims all the dead nodes");
+   check(bm.getNumDeadNodes() == 0, "no dead node after GC");
+   check(bm.getNumLiveNodes() == nLive, "GC keeps the live nodes");
+   check(bm.getGcRecords().size() == 1 &&
+         bm.getGcRecords()[0]._numReclaimed == nDead, "GC record");
+   check(keep == copy && sameTruthTable(bm, keep, copy),
+         "a referenced BDD survives GC");
+
+   // automatic GC at the beginning of the next operation
+   bm.setGcThreshold(1);
+   {
+      BddNode tmp = randomBdd(bm, seed, 40);
+   }
+   check(bm.getNumDeadNodes() > 0, "dead nodes before automatic GC");
+   BddNode r = keep & bm.getSupport(1);
+   check(bm.getGcRecords().size() == 2, "GC triggered by the threshold");
+
+   ostringstream os;
+   bm.printGcStats(os);
+   ostringstream live;
+   live << "#Live nodes      : " << bm.getNumLiveNodes();
+   check(os.str().find(live.str()) != string::npos, "printGcStats()");
+}
+
+// A _refCount sticks at BDD_REF_MAX, and such a node is never collected
+// ==> 2^32 references take too long; the node is driven to saturation
+//     only with a narrow _refCount (i.e. make test-refsat)
+static void
+testRefCount()
+{
+   cout << "[test] saturating reference counts" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   bm.setGcThreshold(0);
+   {
+      BddNode one = BddNode::_one;
+      check(one.getRefCount() == BDD_REF_MAX, "the terminal is saturated");
+   }
+   check(BddNode::_one.getRefCount() == BDD_REF_MAX,
+         "a saturated _refCount stays put");
+   if (BDD_REF_MAX > (size_t(1) << 24)) {
+      cout << "  (saturation skipped: " << BDD_REF_BITS
+           << "-bit _refCount; see test-refsat)" << endl;
+      return;
+   }
+   BddNode* f = new BddNode(bm.getSupport(1) & bm.getSupport(2));
+   size_t e = (*f)();
+   // The copies are never destroyed; they hold the references
+   alignas(BddNode) char buf[sizeof(BddNode)];
+   for (size_t i = f->getRefCount(); i < BDD_REF_MAX; ++i)
+      new (buf) BddNode(*f);
+   check(f->getRefCount() == BDD_REF_MAX, "driven to saturation");
+   {
+      BddNode g = *f;
+      check(g.getRefCount() == BDD_REF_MAX, "no wrap-around");
+   }
+   check(f->getRefCount() == BDD_REF_MAX, "stays put after a release");
+   delete f;
+   size_t nLive = bm.getNumLiveNodes();
+   bm.garbageCollect();
+   check(bm.getNumLiveNodes() == nLive, "a saturated node is not dead");
+   BddNode h = bm.getSupport(1) & bm.getSupport(2);
+   check(h() == e && h.getRefCount() == BDD_REF_MAX,
+         "a saturated node is never collected");
+}
+
+static void
+testCache()
+{
+   cout << "[test] computed table" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   BddNode f = bm.getSupport(1) ^ bm.getSupport(3) ^ bm.getSupport(5);
+   BddNode g = (bm.getSupport(2) & bm.getSupport(4)) | bm.getSupport(6);
+   const BddNode& x = bm.getSupport(7);
+   size_t misses = bm.getCacheMisses();
+   BddNode h = bm.ite(f, g, x);
+   check(bm.getCacheMisses() > misses, "a new ite() misses");
+   size_t hits = bm.getCacheHits();
+   BddNode h2 = bm.ite(f, g, x);
+   check(h2 == h, "the same ite() gives the same result");
+   check(bm.getCacheHits() > hits, "the same ite() hits");
+   check(bm.getCacheSize() > 0, "getCacheSize()");
+
+   ostringstream os;
+   bm.printCacheStats(os);
+   ostringstream hitLine;
+   hitLine << "#hits      : " << bm.getCacheHits();
+   check(os.str().find(hitLine.str()) != string::npos, "printCacheStats()");
+
+   // One set of ASSOC_CACHE_WAYS ways: rewriting a key behind a hole
+   // (e.g. left by purgeComputedTable()) must not leave a stale copy
+   typedef pair<BddCacheKey, BddEdge> CacheNode;
+   AssocCache<BddCacheKey, BddEdge> c(ASSOC_CACHE_WAYS);
+   BddCacheKey ka(BDD_OP_ITE, 2, 4, 6), kb(BDD_OP_ITE, 2, 4, 8),
+               kc(BDD_OP_ITE, 2, 4, 10);
+   c.write(ka, 1); c.write(kb, 2); c.write(kc, 3);
+   c[0] = CacheNode();
+   c.write(ka, 5);
+   size_t na = 0;
+   for (size_t i = 0; i < c.size(); ++i)
+      if (c[i].first == ka) ++na;
+   BddEdge d = 0;
+   check(na == 1 && c.read(ka, d) && d == 5, "no stale copy of a key");
+   check(c.read(kb, d) && d == 2, "the other keys are kept");
+}
+
+// The binary apply kernels against ite() and the truth tables
+static void
+testApply()
+{
+   cout << "[test] apply" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   const BddNode& one = BddNode::_one;
+   const BddNode& zero = BddNode::_zero;
+   size_t nin = bm.getNumSupports() - 1;
+   unsigned seed = 3;
+   for (int i = 0; i < 20; ++i) {
+      BddNode f = randomBdd(bm, seed, 20), g = randomBdd(bm, seed, 20);
+      BddNode a = bm.bddAnd(f, g), o = bm.bddOr(f, g), x = bm.bddXor(f, g);
+      check(a == bm.ite(f, g, zero), "bddAnd() = ite(f, g, 0)");
+      check(o == bm.ite(f, one, g), "bddOr() = ite(f, 1, g)");
+      check(x == bm.ite(f, ~g, g), "bddXor() = ite(f, ~g, g)");
+      check(bm.bddNand(f, g) == ~a, "bddNand() = ~bddAnd()");
+      check(bm.bddXnor(f, g) == ~x, "bddXnor() = ~bddXor()");
+      check((f & g) == a && (f | g) == o && (f ^ g) == x, "&, |, ^");
+      bool ok = true;
+      for (size_t p = 0; p < (size_t(1) << nin); ++p) {
+         string s = toPattern(nin, p);
+         int vf = bm.evalCube(f, s), vg = bm.evalCube(g, s);
+         ok = ok && bm.evalCube(a, s) == (vf & vg)
+                 && bm.evalCube(o, s) == (vf | vg)
+                 && bm.evalCube(x, s) == (vf ^ vg);
+      }
+      check(ok, "apply against the truth tables");
+   }
+}
+
+// Both ite() engines against the AND/OR kernels, which do not share the
+// computed table entries of ite()
+static void
+testIterativeIte()
+{
+   cout << "[test] iterative ite" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   unsigned seed = 4;
+   for (int i = 0; i < 20; ++i) {
+      BddNode f = randomBdd(bm, seed, 20), g = randomBdd(bm, seed, 20),
+              h = randomBdd(bm, seed, 20);
+      BddNode ref = (f & g) | (~f & h);
+      bm.setIterativeIte(i % 2 == 0);
+      check(bm.ite(f, g, h) == ref, "ite() = (f & g) | (~f & h)");
+      bm.setIterativeIte(i % 2 != 0);
+      check(bm.ite(f, g, h) == ref, "ite() by the other engine");
+   }
+}
+
+// The parallel engine (with and without forking) against the serial one
+// ==> the same nodes, as they share _uniqueTable
+static void
+testParallel()
+{
+   cout << "[test] parallel ite" << endl;
+   BddMgr bm(14, 127, 61);
+   bm.makeCurrent();
+   unsigned seed = 14;
+   vector<BddNode> fs, refs;
+   for (int i = 0; i < 10; ++i) {
+      BddNode f = randomBdd(bm, seed, 40), g = randomBdd(bm, seed, 40),
+              h = randomBdd(bm, seed, 40);
+      fs.push_back(f); fs.push_back(g); fs.push_back(h);
+      refs.push_back(bm.ite(f, g, h));
+      refs.push_back(f & g);
+      refs.push_back(g | h);
+      refs.push_back(f ^ h);
+   }
+   // After the garbage collection, only the nodes of fs and refs remain
+   // ==> the spare nodes of the threads must be back in the pool
+   bm.garbageCollect();
+   size_t numNodes = bm.getNumNodes();
+   unsigned nts[] = { 1, 4, 3, 0 };
+   for (unsigned nt : nts) {
+      bm.setNumThreads(nt);
+#ifdef BDD_COMPACT_NODE
+      check(bm.getNumThreads() == 0, "setNumThreads() is rejected");
+#else
+      check(bm.getNumThreads() == nt, "setNumThreads()");
+#endif
+      for (size_t i = 0; i < fs.size(); i += 3) {
+         const BddNode *r = &refs[i / 3 * 4];
+         const BddNode &f = fs[i], &g = fs[i + 1], &h = fs[i + 2];
+         check(bm.ite(f, g, h) == r[0], "parallel ite()");
+         check((f & g) == r[1], "parallel &");
+         check((g | h) == r[2], "parallel |");
+         check((f ^ h) == r[3], "parallel ^");
+         // New nodes, gone by the next garbageCollect()
+         BddNode t = (f | g) ^ (g & h);
+         check((t ^ (f | g)) == (g & h), "parallel new nodes");
+      }
+      bm.garbageCollect();
+      check(bm.getNumNodes() == numNodes, "parallel #nodes");
+   }
+
+   // More new nodes in one ite() than _parHash takes (i.e. it grows);
+   // the serial ite() finds the same nodes in _uniqueTable
+   BddMgr bm2(32, 127, 61);
+   bm2.makeCurrent();
+   bm2.setGcThreshold(0);
+   bm2.setNumThreads(4);
+   BddNode f = BddNode::_zero, g = BddNode::_zero;
+   for (unsigned i = 1; i <= 16; i += 2)
+      f |= bm2.getSupport(i) & bm2.getSupport(i + 16);
+   for (unsigned i = 2; i <= 16; i += 2)
+      g |= bm2.getSupport(i) & bm2.getSupport(i + 16);
+   size_t before = bm2.getNumNodes();
+   BddNode r = f | g;
+   check(bm2.getNumNodes() - before > (1 << 15), "parallel big ite()");
+   bm2.setNumThreads(0);
+   before = bm2.getNumNodes();
+   check((f | g) == r && bm2.getNumNodes() == before,
+         "parallel big ite() = serial");
+   bm.makeCurrent();
+
+   // A LockFreeHash takes LOCK_FREE_HASH_PROBES keys of one hash at most
+   LockFreeHash<SameSlotKey, SameSlotKeyOf> lh;
+   lh.init(1);
+   check(lh.size() == LOCK_FREE_HASH_PROBES, "LockFreeHash size");
+   bool ok = true;
+   size_t slot = 0;
+   for (size_t d = 1; d <= LOCK_FREE_HASH_PROBES; ++d)
+      ok = ok && lh.insert(SameSlotKey(d), d, slot) == d && slot == d - 1;
+   check(ok, "LockFreeHash::insert() of new keys");
+   check(lh.insert(SameSlotKey(3), 100, slot) == 3 && lh.find(3) == 3,
+         "LockFreeHash finds a key in");
+   check(lh.insert(SameSlotKey(100), 100, slot) == 0 && lh.find(100) == 0,
+         "LockFreeHash rejects a key out of a full window");
+   lh.clear(0);
+   check(lh.insert(SameSlotKey(100), 100, slot) == 100 && slot == 0,
+         "LockFreeHash::clear()");
+}
+
+// The BddNodes must keep their functions across swapLevels() and reorder()
+static void
+testReorder()
+{
+   cout << "[test] reordering" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   unsigned seed = 5;
+   vector<BddNode> fs;
+   vector<string> tts;
+   for (int i = 0; i < 8; ++i) {
+      fs.push_back(randomBdd(bm, seed, 30));
+      tts.push_back(truthTable(bm, fs.back()));
+   }
+   size_t nin = bm.getNumSupports() - 1;
+   bool ok = true;
+   for (unsigned l = 1; l < nin; l += 2) {
+      unsigned x = bm.getVarOfLevel(l), y = bm.getVarOfLevel(l + 1);
+      bm.swapLevels(l);
+      ok = ok && bm.getLevelOfVar(x) == l + 1 && bm.getLevelOfVar(y) == l
+              && bm.getVarOfLevel(l) == y && bm.getVarOfLevel(l + 1) == x;
+   }
+   check(ok, "swapLevels() swaps the variables of two levels");
+   check(bm.getNumReorders() == nin / 2, "swapLevels() is counted");
+   for (size_t i = 0; i < fs.size(); ++i)
+      check(truthTable(bm, fs[i]) == tts[i], "functions after swapLevels()");
+
+   size_t before = bm.getNumLiveNodes();
+   check(bm.reorder() <= before, "reorder() does not grow the BDDs");
+   for (size_t i = 0; i < fs.size(); ++i)
+      check(truthTable(bm, fs[i]) == tts[i], "functions after reorder()");
+
+   // A time limit stops sifting early, but the functions are kept
+   bm.setReorderTimeLimit(1e-9);
+   bm.reorder();
+   bm.setReorderTimeLimit(0);
+   for (size_t i = 0; i < fs.size(); ++i)
+      check(truthTable(bm, fs[i]) == tts[i], "functions after a timeout");
+}
+
+// (x1 == x(n+1)) & ... & (xn == x2n) takes O(2^n) nodes in the initial
+// order, and O(n) after sifting
+static void
+testAutoReorder()
+{
+   cout << "[test] automatic reordering" << endl;
+   const unsigned n = 14;
+   BddMgr bm(2 * n, 1 << 10, 1 << 12);
+   bm.makeCurrent();
+   bm.setAutoReorder(true);
+   BddNode f = BddNode::_one;
+   for (unsigned i = 1; i <= n; ++i)
+      f &= ~(bm.getSupport(i) ^ bm.getSupport(i + n));
+   check(bm.getNumReorders() > 0, "automatic reordering is triggered");
+   check(bm.getNumLiveNodes() < BDD_REORDER_MIN_NODES,
+         "automatic reordering shrinks the BDD");
+
+   unsigned seed = 6;
+   bool ok = true;
+   for (int k = 0; k < 1000; ++k) {
+      seed = seed * 1103515245 + 12345;
+      string s = toPattern(2 * n, seed);
+      // make x(i+n) = xi in half of the patterns
+      if (k % 2) for (unsigned i = 0; i < n; ++i) s[i + n] = s[i];
+      bool eq = (s.substr(0, n) == s.substr(n));
+      ok = ok && bm.evalCube(f, s) == (eq? 1 : 0);
+   }
+   check(ok, "the function after automatic reordering");
+
+   // getLeftCofactor()/getRightCofactor() below the top level are
+   // accessors ==> no reordering, even when it is due
+   // (x1 & x13) | ... | (x12 & x24) is exponential in this order
+   BddMgr rm(24, 1 << 10, 1 << 12);
+   rm.makeCurrent();
+   BddNode g = BddNode::_zero;
+   for (unsigned i = 1; i <= 12; ++i)
+      g |= rm.getSupport(i) & rm.getSupport(i + 12);
+   check(rm.getNumLiveNodes() >= BDD_REORDER_MIN_NODES, "a large BDD");
+   rm.setAutoReorder(true);
+   unsigned v = rm.getVarOfLevel(5);
+   BddNode g1 = g.getLeftCofactor(5), g0 = g.getRightCofactor(5);
+   check(rm.getNumReorders() == 0 && rm.getVarOfLevel(5) == v,
+         "the cofactor accessors do not reorder");
+   const BddNode& x = rm.getSupport(v);
+   check(g1 == rm.cofactor(g, x) && g0 == rm.cofactor(g, ~x) &&
+         rm.getNumReorders() > 0, "the cofactor accessors");
+}
+
+// The per-level subtables must hold exactly the nodes of their levels
+static void
+testLevels()
+{
+   cout << "[test] level subtables" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   bm.setGcThreshold(0);
+   unsigned seed = 7;
+   vector<BddNode> fs;
+   for (int i = 0; i < 8; ++i) fs.push_back(randomBdd(bm, seed, 30));
+   for (int pass = 0; pass < 2; ++pass) {
+      bm.garbageCollect();   // ==> every node in the subtables is live
+      size_t total = 0;
+      bool ok = true;
+      for (unsigned l = 0; l < bm.getNumLevels(); ++l) {
+         size_t n = 0;
+         for (BddMgr::BddLevelIter li = bm.levelBegin(l);
+              li != bm.levelEnd(l); ++li, ++n)
+            ok = ok && BddNode((*li).second).getLevel() == l;
+         ok = ok && n == bm.getLevelSize(l);
+         total += n;
+      }
+      check(ok, "levelBegin() ~ levelEnd() go through one level");
+      check(total == bm.getNumNodes(), "the levels cover all the nodes");
+      check(bm.getLevelSize(0) == 1, "only the terminal at level 0");
+      bm.swapLevels(3);
+   }
+}
+
+// nodeMove() against the truth tables with the variables renamed
+static void
+testNodeMove()
+{
+   cout << "[test] nodeMove" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   const BddNode &x2 = bm.getSupport(2), &x3 = bm.getSupport(3),
+                 &x5 = bm.getSupport(5), &x6 = bm.getSupport(6),
+                 &x7 = bm.getSupport(7);
+   // Down: levels 5 ~ 7 to 2 ~ 4
+   BddNode f = (x5 & ~x6) ^ x7;
+   bool isMoved = false;
+   BddNode g = f.nodeMove(5, 2, isMoved);
+   check(isMoved, "nodeMove() down is done");
+   bool ok = true;
+   for (size_t p = 0; p < (size_t(1) << nin); ++p) {
+      string s = toPattern(nin, p), t(nin, '0');
+      for (unsigned v = 2; v <= 4; ++v) t[v + 3 - 1] = s[v - 1];
+      ok = ok && bm.evalCube(g, s) == bm.evalCube(f, t);
+   }
+   check(ok, "nodeMove() down renames the variables");
+
+   // Up: levels 2 ~ 3 to 6 ~ 7
+   BddNode h = x2 | ~x3;
+   g = h.nodeMove(2, 6, isMoved);
+   check(isMoved && g == (bm.getSupport(6) | ~x7), "nodeMove() up");
+
+   // A node below fromLevel ==> no move
+   BddNode k = f & bm.getSupport(1);
+   g = k.nodeMove(5, 2, isMoved);
+   check(!isMoved && g == k, "nodeMove() with a node below fromLevel");
+}
+
+// The visited marks of print(), whose stores are reused by the later
+// traversals (see BddNodeMarks)
+static void
+testTraverse()
+{
+   cout << "[test] traversal marks" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   BddNode f = bm.getSupport(1) & bm.getSupport(2) & bm.getSupport(3);
+   ostringstream os;
+   os << f;
+   check(os.str().find("#BddNodes : 4\n") != string::npos,
+         "x1 & x2 & x3 has 4 nodes");
+   unsigned seed = 25;
+   BddNode g = randomBdd(bm, seed, 40);
+   ostringstream og;
+   og << g;
+   bool ok = true;
+   for (int i = 0; i < 100; ++i) {
+      // New nodes in between; the stores are reused by g and f in turn
+      BddNode h = randomBdd(bm, seed, 20);
+      ostringstream oh, oi;
+      oh << g;
+      oi << f;
+      ok = ok && oh.str() == og.str() && oi.str() == os.str();
+   }
+   check(ok, "the same output from every traversal");
+
+   // More nodes than half the first 64 slots of a store (i.e. it grows
+   // within the traversal), against the nodes counted by a set
+   // (x1 & x6) | ... | (x5 & x10) is exponential in this order
+   BddNode k = BddNode::_zero;
+   for (unsigned i = 1; i <= 5; ++i)
+      k |= bm.getSupport(i) & bm.getSupport(i + 5);
+   set<size_t> nodes;
+   vector<BddNode> todo(1, k);
+   while (!todo.empty()) {
+      BddNode n = todo.back();
+      todo.pop_back();
+      if (!nodes.insert(n() & ~size_t(BDD_NEG_EDGE)).second ||
+          n.getLevel() == 0) continue;
+      todo.push_back(n.getLeft());
+      todo.push_back(n.getRight());
+   }
+   ostringstream ok2;
+   ok2 << k;
+   ostringstream numLine;
+   numLine << "#BddNodes : " << nodes.size() << "\n";
+   check(nodes.size() > 32 && ok2.str().find(numLine.str()) != string::npos,
+         "the marks of a large BDD");
+}
+
+// Quantification over a cube against the cofactor expansions
+//    exists: f|x | f|~x;  forall: f|x & f|~x;  unique: f|x ^ f|~x
+// which are applied one variable at a time
+static void
+testQuantify()
+{
+   cout << "[test] quantification" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   unsigned seed = 8;
+   for (int i = 0; i < 20; ++i) {
+      BddNode f = randomBdd(bm, seed, 30);
+      BddNode cube = BddNode::_one;
+      BddNode e = f, a = f, u = f;
+      for (unsigned v = 1; v <= 8; ++v) {
+         seed = seed * 1103515245 + 12345;
+         if ((seed >> 10) % 3) continue;
+         const BddNode& x = bm.getSupport(v);
+         cube &= x;
+         e = bm.cofactor(e, x) | bm.cofactor(e, ~x);
+         a = bm.cofactor(a, x) & bm.cofactor(a, ~x);
+         u = bm.cofactor(u, x) ^ bm.cofactor(u, ~x);
+      }
+      check(bm.bddExists(f, cube) == e && f.exists(cube) == e, "exists");
+      check(bm.bddForall(f, cube) == a && f.forall(cube) == a, "forall");
+      check(bm.bddUnique(f, cube) == u && f.unique(cube) == u, "unique");
+   }
+   // single variables, as cubes and as literals of both phases
+   BddNode f = randomBdd(bm, seed, 30);
+   for (unsigned v = 1; v <= 8; ++v) {
+      const BddNode& x = bm.getSupport(v);
+      BddNode f1 = bm.cofactor(f, x), f0 = bm.cofactor(f, ~x);
+      check(f.forall(x) == (f1 & f0) && f.forall(~x) == (f1 & f0),
+            "forall of one variable");
+      check(f.unique(x) == (f1 ^ f0) && f.unique(~x) == (f1 ^ f0),
+            "unique of one variable");
+   }
+}
+
+// bddAndExists(f, g, cube) = (f & g).exists(cube), where the operands
+// are over variables 1 ~ 8, and cube also has variables 9 ~ 12
+static void
+testAndExists()
+{
+   cout << "[test] andExists" << endl;
+   BddMgr bm(12, 127, 61);
+   bm.makeCurrent();
+   unsigned seed = 10;
+   for (int i = 0; i < 30; ++i) {
+      BddNode f = randomBdd(bm, seed, 30, 8), g = randomBdd(bm, seed, 30, 8);
+      BddNode cube = BddNode::_one;
+      // i = 0: the empty cube
+      for (unsigned v = 1; i > 0 && v <= 12; ++v) {
+         seed = seed * 1103515245 + 12345;
+         if ((seed >> 10) % 3 == 0) cube &= bm.getSupport(v);
+      }
+      // i = 1: variables outside both supports only
+      if (i == 1) cube = bm.getSupport(9) & bm.getSupport(11);
+      if (i == 2) g = BddNode::_one;
+      if (i == 3) g = ~f;
+      check(bm.bddAndExists(f, g, cube) == (f & g).exists(cube),
+            "bddAndExists() = (f & g).exists(cube)");
+   }
+}
+
+// compose(f, v, g) = ite(g, f|v=1, f|v=0), and vecCompose() against the
+// truth table of f on the values of gs
+static void
+testCompose()
+{
+   cout << "[test] compose" << endl;
+   BddMgr bm(7, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   unsigned seed = 9;
+   for (int i = 0; i < 20; ++i) {
+      BddNode f = randomBdd(bm, seed, 30), g = randomBdd(bm, seed, 30);
+      unsigned v = 1 + i % nin;
+      const BddNode& x = bm.getSupport(v);
+      BddNode ref = bm.ite(g, bm.cofactor(f, x), bm.cofactor(f, ~x));
+      check(bm.compose(f, v, g) == ref && f.compose(v, g) == ref,
+            "compose(f, v, g) = ite(g, f|v=1, f|v=0)");
+   }
+   for (int i = 0; i < 10; ++i) {
+      BddNode f = randomBdd(bm, seed, 30);
+      // a null BddNode means no substitution
+      vector<BddNode> gs(nin + 1);
+      for (size_t v = 1; v <= nin; ++v)
+         if ((v + i) % 3) gs[v] = randomBdd(bm, seed, 10);
+      BddNode h = bm.vecCompose(f, gs);
+      bool ok = true;
+      for (size_t p = 0; p < (size_t(1) << nin); ++p) {
+         string s = toPattern(nin, p), t = s;
+         for (size_t v = 1; v <= nin; ++v)
+            if (gs[v]() != 0) t[v - 1] = '0' + bm.evalCube(gs[v], s);
+         ok = ok && bm.evalCube(h, s) == bm.evalCube(f, t);
+      }
+      check(ok, "vecCompose() against the truth tables");
+   }
+
+   // vecCompose() where its BddOpGuard triggers the reordering
+   // ==> x13 is moved down from level 13 to next to x1 by sifting
+   BddMgr rm(24, 1 << 10, 1 << 12);
+   rm.makeCurrent();
+   BddNode f = BddNode::_zero;
+   for (unsigned i = 1; i <= 12; ++i)
+      f |= rm.getSupport(i) & rm.getSupport(i + 12);
+   check(rm.getNumLiveNodes() >= BDD_REORDER_MIN_NODES, "a large BDD");
+   vector<BddNode> gs(25);
+   gs[13] = ~rm.getSupport(2);
+   rm.setAutoReorder(true);
+   BddNode h = rm.vecCompose(f, gs);
+   check(rm.getNumReorders() > 0, "vecCompose() triggers the reordering");
+   check(h == rm.compose(f, 13, gs[13]),
+         "vecCompose() across the reordering = compose()");
+}
+
+// constrain() and restrict() agree with f on the care set c
+static void
+testGenCofactor()
+{
+   cout << "[test] constrain and restrict" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   const BddNode& one = BddNode::_one;
+   const BddNode& zero = BddNode::_zero;
+   unsigned seed = 10;
+   for (int i = 0; i < 30; ++i) {
+      BddNode f = randomBdd(bm, seed, 30), c = randomBdd(bm, seed, 30);
+      BddNode fc = bm.constrain(f, c), fr = bm.restrict(f, c);
+      check((fc & c) == (f & c) && f.constrain(c) == fc,
+            "constrain(f, c) & c = f & c");
+      check((fr & c) == (f & c) && f.restrict(c) == fr,
+            "restrict(f, c) & c = f & c");
+      check(bm.constrain(f, one) == f && bm.restrict(f, one) == f,
+            "c = 1 ==> f");
+      check(bm.constrain(f, zero) == zero && bm.restrict(f, zero) == zero,
+            "c = 0 ==> 0");
+      check(bm.constrain(f, f) == one || f == zero, "constrain(f, f) = 1");
+   }
+}
+
+// countCube() against the cubes enumerated, and on a BDD of 2^70 paths
+static void
+testCountCube()
+{
+   cout << "[test] countCube" << endl;
+   BddMgr bm(140, 1 << 10, 1 << 12);
+   bm.makeCurrent();
+   unsigned seed = 11;
+   for (int i = 0; i < 10; ++i) {
+      BddNode f = randomBdd(bm, seed, 40, 12);
+      BigNum n = f.countCubeExact();
+      size_t m = 0;
+      for (BddCubeIter ci = f.cubeBegin(); ci != f.cubeEnd(); ++ci) ++m;
+      check(n == BigNum(m) && f.countCube() == m &&
+            f.getAllCubes().size() == m, "countCube() = #cubes enumerated");
+      BddNode u = BddNode::_zero;
+      for (size_t j = 0; j < m; ++j) u |= f.getCube(j);
+      check(u == f, "the cubes of getCube() cover f");
+      checkCubeIter(bm, f);
+   }
+   check(BddNode::_zero.countCube() == 0 &&
+         BddNode::_zero.countCubeExact().isZero() &&
+         BddNode::_zero.getCube(3) == BddNode::_zero, "no cube of 0");
+
+   // (x1 == x2) & ... & (x139 == x140): two paths per pair
+   BddNode eq = BddNode::_one;
+   for (unsigned i = 1; i < 140; i += 2)
+      eq &= bm.bddXnor(bm.getSupport(i), bm.getSupport(i + 1));
+   check(eq.countCubeExact() == BigNum::pow2(70),
+         "countCubeExact() beyond 64 bits");
+   check(eq.countCube() == ~size_t(0), "countCube() saturates");
+   check(eq.getCube(12345) != BddNode::_zero, "getCube() of a huge count");
+
+   // getCube() where its BddOpGuard triggers the reordering
+   // ==> the path counts must be of the new levels
+   // (x1 & x13) | ... | (x12 & x24) is exponential in this order
+   BddMgr rm(24, 1 << 10, 1 << 12);
+   rm.makeCurrent();
+   BddNode f = BddNode::_zero;
+   for (unsigned i = 1; i <= 12; ++i)
+      f |= rm.getSupport(i) & rm.getSupport(i + 12);
+   size_t m = f.countCube();
+   check(rm.getNumLiveNodes() >= BDD_REORDER_MIN_NODES, "a large BDD");
+   rm.setAutoReorder(true);
+   BddNode c = f.getCube(m / 2);
+   check(rm.getNumReorders() > 0, "getCube() triggers the reordering");
+   check(c != BddNode::_zero && (c & ~f) == BddNode::_zero,
+         "getCube() across the reordering is a cube of f");
+   check(c == f.getAllCubes()[(m / 2) % f.countCube()],
+         "getCube() across the reordering");
+   // The patterns are of the variables, not of the (new) levels
+   checkCubeIter(rm, f);
+}
+
+// BddCubeIter against getAllCubes(), cube by cube, without creating any
+// node
+static void
+checkCubeIter(BddMgr& bm, const BddNode& f)
+{
+   vector<BddNode> cubes = f.getAllCubes();
+   size_t numNodes = bm.getNumNodes();
+   vector<string> pats;
+   for (BddCubeIter ci = f.cubeBegin(); ci != f.cubeEnd(); ++ci)
+      pats.push_back(*ci);
+   check(bm.getNumNodes() == numNodes, "BddCubeIter creates no node");
+   bool ok = (pats.size() == cubes.size());
+   for (size_t k = 0; ok && k < pats.size(); ++k)
+      ok = (pats[k].size() == bm.getNumSupports() - 1) &&
+           (cubeBdd(bm, pats[k]) == cubes[k]);
+   check(ok, "BddCubeIter in the order of getAllCubes()");
+}
+
+// satCountExact() and satCountLog2() against the minterms enumerated
+static void
+testSatCount()
+{
+   cout << "[test] satCount" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   unsigned seed = 17;
+   for (int i = 0; i < 20; ++i) {
+      BddNode f = randomBdd(bm, seed, 30);
+      string t = truthTable(bm, f);
+      size_t m = 0;
+      for (size_t p = 0; p < t.size(); ++p) m += (t[p] == '1');
+      check(bm.satCountExact(f, nin) == BigNum(m), "satCountExact()");
+      check(bm.satCount(f, nin) == m, "satCount()");
+      check(m? fabsl(bm.satCountLog2(f, nin) - log2l(m)) < 1e-9 :
+               isinf(bm.satCountLog2(f, nin)), "satCountLog2()");
+      // over more variables than the BDD has
+      check(bm.satCountExact(f, nin + 5) == BigNum(m) << 5,
+            "satCountExact() over more variables");
+   }
+   check(bm.satCountExact(BddNode::_zero, nin).isZero() &&
+         bm.satCountExact(BddNode::_one, nin) == BigNum::pow2(nin),
+         "satCountExact() of the constants");
+
+   // Beyond 16382 levels, where the densities underflow long double
+   const unsigned n = 20000;
+   BddMgr big(n, 1 << 10, 1 << 10);
+   big.makeCurrent();
+   BddNode c = BddNode::_one;
+   for (unsigned v = 1; v <= n; ++v) c &= big.getSupport(v);
+   check(big.satCountLog2(c, n) == 0 && big.satCount(c, n) == 1,
+         "satCountLog2() and satCount() of a cube of 20000 variables");
+   check(fabsl(big.satCountLog2(~c, n) - n) < 1e-9 &&
+         isinf(big.satCount(~c, n)), "satCountLog2() beyond 2^16384");
+   check(isinf(big.satCountLog2(BddNode::_zero, n)), "satCountLog2() of 0");
+}
+
+// probability() with all P(x) = 0.5 is the minterm density, and a
+// non-uniform case is checked against the expansion by hand
+static void
+testProbability()
+{
+   cout << "[test] probability" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   vector<double> half(nin + 1, 0.5);
+   unsigned seed = 12;
+   vector<BddNode> fs;
+   for (int i = 0; i < 10; ++i) {
+      BddNode f = randomBdd(bm, seed, 30);
+      fs.push_back(f);
+      fs.push_back(~f);
+   }
+   vector<double> ps;
+   bm.probability(fs, half, ps);
+   for (size_t i = 0; i < fs.size(); ++i) {
+      double d = double(bm.satCount(fs[i], nin) / (1 << nin));
+      check(fabs(bm.probability(fs[i], half) - d) < 1e-12 &&
+            fabs(fs[i].probability(half) - d) < 1e-12,
+            "probability() with P(x) = 0.5 = satCount() / 2^n");
+      check(fabs(ps[i] - d) < 1e-12, "probability() of a vector of BDDs");
+   }
+
+   // P(x1 & ~x2 | x3) = P(x1 & ~x2) + P(x3) - P(x1 & ~x2 & x3)
+   vector<double> probs(nin + 1, 0.5);
+   probs[1] = 0.9; probs[2] = 0.3; probs[3] = 0.2;
+   BddNode f = (bm.getSupport(1) & ~bm.getSupport(2)) | bm.getSupport(3);
+   double p12 = 0.9 * (1 - 0.3), p = p12 + 0.2 - p12 * 0.2;
+   check(fabs(bm.probability(f, probs) - p) < 1e-12, "P(x1 & ~x2 | x3)");
+   check(fabs(bm.probability(~f, probs) - (1 - p)) < 1e-12,
+         "P(~f) = 1 - P(f)");
+}
+
+// evalBatch() against evalCube() on (64 * 3 - 27) random patterns
+// ==> the last word is partly filled, and the rest of it is all 0
+static void
+testEvalBatch()
+{
+   cout << "[test] evalBatch" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   const size_t nw = 3, np = 64 * nw - 27;
+   unsigned seed = 21;
+   vector<size_t> pats(np);
+   vector<unsigned long long> words((nin + 1) * nw, 0);
+   for (size_t j = 0; j < np; ++j) {
+      seed = seed * 1103515245 + 12345;
+      pats[j] = (seed >> 8) % (size_t(1) << nin);
+      for (size_t v = 1; v <= nin; ++v)
+         if (pats[j] & (size_t(1) << (v - 1)))
+            words[v * nw + j / 64] |= 1ULL << (j % 64);
+   }
+   vector<unsigned long long> w1(nin + 1);
+   for (size_t v = 1; v <= nin; ++v) w1[v] = words[v * nw];
+   for (int i = 0; i < 10; ++i) {
+      BddNode f = randomBdd(bm, seed, 30);
+      if (i == 0) f = BddNode::_one;
+      if (i == 1) f = BddNode::_zero;
+      vector<unsigned long long> res;
+      bm.evalBatch(f, words, nw, res);
+      unsigned long long r1 = bm.evalBatch(f, w1);
+      bool ok = res.size() == nw, ok1 = true;
+      for (size_t j = 0; ok && j < np; ++j) {
+         int v = bm.evalCube(f, toPattern(nin, pats[j]));
+         ok = int((res[j / 64] >> (j % 64)) & 1) == v;
+         if (j < 64) ok1 = ok1 && int((r1 >> j) & 1) == v;
+      }
+      check(ok, "evalBatch() of 3 words = evalCube()");
+      check(ok1, "evalBatch() of 1 word = evalCube()");
+   }
+}
+
+// The samples of BddSampler satisfy f, and each minterm of f is drawn
+// about as often as the others
+static void
+testSampler()
+{
+   cout << "[test] sampler" << endl;
+   BddMgr bm(5, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   const BddNode& x1 = bm.getSupport(1);
+   const BddNode& x2 = bm.getSupport(2);
+   const BddNode& x3 = bm.getSupport(3);
+   // 20 of the 32 minterms; x4 and x5 are not in the BDD
+   BddNode f = x1 | (x2 & x3);
+   BddSampler sampler(f, 7);
+   const size_t n = 20000;
+   vector<vector<bool> > samples;
+   check(sampler.sample(n, samples) == n && samples.size() == n,
+         "sample(n) draws n minterms");
+   vector<size_t> freq(size_t(1) << nin, 0);
+   bool ok = true;
+   for (size_t i = 0; i < n; ++i) {
+      size_t p = 0;
+      for (size_t v = 1; v <= nin; ++v)
+         if (samples[i][v]) p |= size_t(1) << (v - 1);
+      ok = ok && bm.evalCube(f, toPattern(nin, p)) == 1;
+      ++freq[p];
+   }
+   check(ok, "every sample satisfies f");
+   // n / 20 = 1000 per minterm; 6 sigmas is about 190
+   size_t lo = n, hi = 0, m = 0;
+   for (size_t p = 0; p < freq.size(); ++p) {
+      if (freq[p] == 0) continue;
+      ++m;
+      lo = min(lo, freq[p]);
+      hi = max(hi, freq[p]);
+   }
+   check(m == 20 && lo > 800 && hi < 1200, "uniform over the minterms");
+
+   // the same seed, the same samples
+   BddSampler s2(f, 7);
+   vector<vector<bool> > samples2;
+   s2.sample(n, samples2);
+   check(samples2 == samples, "seeded");
+
+   // after reordering, the densities are taken again
+   bm.reorder();
+   bm.swapLevels(1);
+   vector<bool> bits;
+   ok = true;
+   for (size_t i = 0; i < 100; ++i) {
+      ok = ok && sampler.sample(bits);
+      size_t p = 0;
+      for (size_t v = 1; v <= nin; ++v)
+         if (bits[v]) p |= size_t(1) << (v - 1);
+      ok = ok && bm.evalCube(f, toPattern(nin, p)) == 1;
+   }
+   check(ok, "sample() after reordering");
+
+   BddSampler s0(BddNode::_zero);
+   check(!s0.sample(bits) && s0.sample(10, samples) == 0 && samples.empty(),
+         "no sample of 0");
+}
+
+// BddCompiled::eval() against evalCube(), for the roots of random BDDs,
+// their complements and the constants, also after the BddMgr reorders
+static void
+testCompiled()
+{
+   cout << "[test] compiled BDD" << endl;
+   BddMgr bm(10, 127, 61);
+   bm.makeCurrent();
+   size_t nin = bm.getNumSupports() - 1;
+   unsigned seed = 25;
+   vector<BddNode> roots;
+   roots.push_back(BddNode::_one);
+   roots.push_back(BddNode::_zero);
+   for (int i = 0; i < 8; ++i) {
+      BddNode f = randomBdd(bm, seed, 30);
+      roots.push_back(f);
+      roots.push_back(~f);
+   }
+   roots.push_back(bm.getSupport(3));
+   BddCompiled comp(roots);
+   check(comp.getNumRoots() == roots.size(), "getNumRoots()");
+   BddCompiled comp1(roots[2]);
+   bm.reorder();
+   bool ok = true, ok1 = true;
+   vector<bool> bits(nin + 1);
+   for (int i = 0; i < 200; ++i) {
+      seed = seed * 1103515245 + 12345;
+      size_t p = (seed >> 8) % (size_t(1) << nin);
+      string s = toPattern(nin, p);
+      for (size_t v = 1; v <= nin; ++v) bits[v] = (s[v - 1] == '1');
+      for (size_t r = 0; r < roots.size(); ++r) {
+         bool v = (bm.evalCube(roots[r], s) == 1);
+         ok = ok && comp.eval(r, bits) == v && comp.eval(r, s) == v;
+      }
+      ok1 = ok1 && comp1.eval(0, bits) == (bm.evalCube(roots[2], s) == 1);
+   }
+   check(ok, "BddCompiled::eval() = evalCube()");
+   check(ok1, "BddCompiled of one root");
+}
+
+// isop(l, u) is a cover in [l, u], of the cubes returned, and is
+// irredundant: without any cube, it no longer covers l, and without any
+// literal of a cube, it is no longer in u
+static void
+testIsop()
+{
+   cout << "[test] isop" << endl;
+   BddMgr bm(8, 127, 61);
+   bm.makeCurrent();
+   const BddNode& zero = BddNode::_zero;
+   unsigned seed = 23;
+   for (int i = 0; i < 20; ++i) {
+      BddNode f = randomBdd(bm, seed, 30), dc = randomBdd(bm, seed, 30);
+      // u == l for the even ones; a don't-care gap for the odd ones
+      BddNode l = (i % 2)? (f & ~dc) : f, u = (i % 2)? (f | dc) : f;
+      if (i == 0) l = u = zero;
+      if (i == 2) l = u = BddNode::_one;
+      if (i % 2) check(l != u || dc == zero, "a don't-care gap");
+      vector<string> cubes;
+      BddNode cover = bm.isop(l, u, &cubes);
+      check((l & ~cover) == zero && (cover & ~u) == zero,
+            "l <= isop(l, u) <= u");
+      check(bm.isop(l, u) == cover, "isop() without the cubes");
+      vector<BddNode> cs;
+      BddNode sum = zero;
+      for (size_t j = 0; j < cubes.size(); ++j) {
+         cs.push_back(cubeBdd(bm, cubes[j]));
+         sum |= cs.back();
+      }
+      check(sum == cover, "the cubes of isop() = the cover");
+      bool ok = true;
+      for (size_t j = 0; j < cs.size(); ++j) {
+         BddNode rest = zero;
+         for (size_t k = 0; k < cs.size(); ++k)
+            if (k != j) rest |= cs[k];
+         ok = ok && (l & ~rest) != zero;
+         for (size_t v = 0; v < cubes[j].size(); ++v) {
+            if (cubes[j][v] == '-') continue;
+            string c = cubes[j];
+            c[v] = '-';
+            ok = ok && (cubeBdd(bm, c) & ~u) != zero;
+         }
+      }
+      check(ok, "isop() is irredundant");
+   }
+}
+
+// Two BddMgrs interleaved on one thread
+// ==> a new BddMgr does not take over, a destroyed one gives the thread
+//     back to the previous one, and the dead nodes are charged to their
+//     own BddMgr
+static void
+testManagers()
+{
+   cout << "[test] interleaved managers" << endl;
+   BddMgr a(8, 127, 61);
+   a.makeCurrent();
+   BddNode x = a.getSupport(1) & a.getSupport(2);
+   {
+      BddMgr b(8, 127, 61);
+      check(a.isCurrent(), "a new BddMgr does not take over");
+   }
+   check(a.isCurrent(), "destroying another BddMgr keeps the current one");
+   BddNode y = x & a.getSupport(3);
+   check(y.countCube() == 1 && y.getLevel() == 3,
+         "x1 & x2 & x3 after another BddMgr is gone");
+   {
+      BddMgr b(8, 127, 61);
+      b.makeCurrent();
+      check(b.isCurrent() && !a.isCurrent(), "makeCurrent()");
+      BddNode z = b.getSupport(4) | b.getSupport(5);
+      BddNode* v = new BddNode(z & b.getSupport(6));
+      size_t aLive = a.getNumLiveNodes(), bLive = b.getNumLiveNodes();
+      a.makeCurrent();
+      BddNode w = y ^ a.getSupport(4);
+      check(b.getNumLiveNodes() == bLive, "no change in the other BddMgr");
+      w = BddNode();
+      check(a.getNumLiveNodes() == aLive, "w is released in its BddMgr");
+      delete v;
+      check(a.getNumLiveNodes() == aLive && b.getNumLiveNodes() == bLive - 1,
+            "v is released in its BddMgr");
+      b.makeCurrent();
+      check(sameTruthTable(b, z, b.getSupport(4) | b.getSupport(5)),
+            "z after switching back");
+   }
+   check(a.isCurrent(), "destroying the current BddMgr restores the last");
+   check(sameTruthTable(a, y, a.getSupport(1) & a.getSupport(2)
+                              & a.getSupport(3)), "y after all");
+
+   // The read-only functions on the BDDs of a, while b is current
+   // ==> the nodes (and the terminal) are those of a
+   vector<string> cubes;
+   for (BddCubeIter ci = y.cubeBegin(); ci != y.cubeEnd(); ++ci)
+      cubes.push_back(*ci);
+   size_t aDead;
+   {
+      BddNode t = y | a.getSupport(5);
+      aDead = a.getNumDeadNodes();
+   }
+   aDead = a.getNumDeadNodes() - aDead;
+   BddMgr b(8, 127, 61);
+   b.makeCurrent();
+   BddNode z = b.getSupport(7) & b.getSupport(8);
+   {
+      size_t n = 0;
+      bool ok = true;
+      for (BddCubeIter ci = y.cubeBegin(); ci != y.cubeEnd(); ++ci, ++n)
+         ok = ok && n < cubes.size() && *ci == cubes[n];
+      check(ok && n == cubes.size() && n == 1, "BddCubeIter of a");
+      BddSampler sampler(y, 3);
+      vector<bool> bits;
+      check(sampler.sample(bits) && bits[1] && bits[2] && bits[3],
+            "BddSampler of a");
+      BddCompiled comp(y);
+      check(comp.eval(0, "11100000") && !comp.eval(0, "11000000"),
+            "BddCompiled of a");
+      check(a.satCount(y, 8) == 32 && a.satCountExact(y, 8) == BigNum(32),
+            "satCount() of a");
+      check(a.evalBatch(y, vector<unsigned long long>(9, ~0ULL)) == ~0ULL,
+            "evalBatch() of a");
+   }
+   b.makeCurrent();
+   size_t bLive = b.getNumLiveNodes();
+   check(aDead > 0 && a.garbageCollect() >= aDead &&
+         a.getNumDeadNodes() == 0, "garbageCollect() of a");
+   check(b.getNumLiveNodes() == bLive && z.getLevel() == 8,
+         "b after garbageCollect() of a");
+
+   // More BddMgrs made current than ever before in this thread
+   // ==> destroying each one gives the thread back to the previous one
+   {
+      const unsigned n = 40;
+      vector<BddMgr*> ms;
+      for (unsigned i = 0; i < n; ++i) {
+         ms.push_back(new BddMgr(4, 31, 31));
+         ms.back()->makeCurrent();
+      }
+      bool ok = ms.back()->isCurrent();
+      for (unsigned i = n; i > 1; --i) {
+         delete ms[i - 1];
+         ok = ok && ms[i - 2]->isCurrent();
+      }
+      delete ms[0];
+      check(ok && b.isCurrent(), "a stack of 40 current BddMgrs");
+   }
+}